@@ -82,10 +82,21 @@ prepare-tmpinfo: FORCE
 		f=tmp/.$${type}info; t=tmp/.config-$${type}.in; \
 		[ "$$t" -nt "$$f" ] || ./scripts/$${type}-metadata.pl $(_ignore) config "$$f" > "$$t" || { rm -f "$$t"; echo "Failed to build $$t"; false; break; }; \
 	done
-	[ tmp/.config-feeds.in -nt tmp/.packageauxvars ] || ./scripts/feeds feed_config > tmp/.config-feeds.in
-	./scripts/package-metadata.pl mk tmp/.packageinfo > tmp/.packagedeps || { rm -f tmp/.packagedeps; false; }
-	./scripts/package-metadata.pl pkgaux tmp/.packageinfo > tmp/.packageauxvars || { rm -f tmp/.packageauxvars; false; }
-	./scripts/package-metadata.pl usergroup tmp/.packageinfo > tmp/.packageusergroup || { rm -f tmp/.packageusergroup; false; }
+	for f in feeds.conf feeds.conf.default feeds feeds/*.index scripts/feeds; do \
+		[ ! -e "$$f" ] || [ tmp/.config-feeds.in -nt "$$f" ] || { \
+			./scripts/feeds feed_config > tmp/.config-feeds.in || { rm -f tmp/.config-feeds.in; exit 1; }; \
+			break; \
+		}; \
+	done
+	for cmd in mk:packagedeps pkgaux:packageauxvars usergroup:packageusergroup; do \
+		t=tmp/.$${cmd#*:}; \
+		for f in tmp/.packageinfo scripts/metadata.pm scripts/package-metadata.pl; do \
+			[ "$$t" -nt "$$f" ] || { \
+				./scripts/package-metadata.pl $${cmd%%:*} tmp/.packageinfo > "$$t" || { rm -f "$$t"; exit 1; }; \
+				break; \
+			}; \
+		done; \
+	done
 	touch $(TOPDIR)/tmp/.build
 
 .config: ./scripts/config/conf $(if $(CONFIG_HAVE_DOT_CONFIG),,prepare-tmpinfo)
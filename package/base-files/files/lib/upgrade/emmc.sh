@@ -3,6 +3,30 @@
 
 . /lib/functions.sh
 
+# Write stdin to block device $1 from 512 byte block $2 on and print the
+# number of 512 byte blocks used. blkwrite writes large chunks, leaves
+# unchanged ones alone and reads the result back, dd is the fallback.
+emmc_write_blocks() {
+	local dev="$1"
+	local seek="${2:-0}"
+	local bytes
+
+	if [ -x /usr/sbin/blkwrite ]; then
+		bytes=$(blkwrite -D -s -V -o $((seek * 512)) "$dev") || return 1
+		echo $(((bytes + 511) / 512))
+	else
+		dd of="$dev" bs=512 seek="$seek" 2>&1 | grep "records out" | cut -d' ' -f1
+	fi
+}
+
+# Give up on a failed write: without a block count emmc_copy_config has
+# nowhere safe to put the backup, so it must not write behind the image
+emmc_write_failed() {
+	v "Failed to write $1 to $2"
+	unset EMMC_KERNEL_BLOCKS EMMC_ROOTFS_BLOCKS
+	return 1
+}
+
 emmc_upgrade_tar() {
 	local tar_file="$1"
 	[ "$CI_KERNPART" -a -z "$EMMC_KERN_DEV" ] && export EMMC_KERN_DEV="$(find_mmc_part $CI_KERNPART $CI_ROOTDEV)"
@@ -10,17 +34,23 @@ emmc_upgrade_tar() {
 	[ "$CI_DATAPART" -a -z "$EMMC_DATA_DEV" ] && export EMMC_DATA_DEV="$(find_mmc_part $CI_DATAPART $CI_ROOTDEV)"
 	local has_kernel
 	local has_rootfs
+	local blocks
 	local board_dir=$(tar tf "$tar_file" | grep -m 1 '^sysupgrade-.*/$')
 	board_dir=${board_dir%/}
 
 	tar tf "$tar_file" ${board_dir}/kernel 1>/dev/null 2>/dev/null && has_kernel=1
 	tar tf "$tar_file" ${board_dir}/root 1>/dev/null 2>/dev/null && has_rootfs=1
 
-	[ "$has_kernel" = 1 -a "$EMMC_KERN_DEV" ] &&
-		export EMMC_KERNEL_BLOCKS=$(($(tar xf "$tar_file" ${board_dir}/kernel -O | dd of="$EMMC_KERN_DEV" bs=512 2>&1 | grep "records out" | cut -d' ' -f1)))
+	[ "$has_kernel" = 1 -a "$EMMC_KERN_DEV" ] && {
+		blocks=$(tar xf "$tar_file" ${board_dir}/kernel -O | emmc_write_blocks "$EMMC_KERN_DEV") && [ -n "$blocks" ] ||
+			emmc_write_failed kernel "$EMMC_KERN_DEV" || return 1
+		export EMMC_KERNEL_BLOCKS=$((blocks))
+	}
 
 	[ "$has_rootfs" = 1 -a "$EMMC_ROOT_DEV" ] && {
-		export EMMC_ROOTFS_BLOCKS=$(($(tar xf "$tar_file" ${board_dir}/root -O | dd of="$EMMC_ROOT_DEV" bs=512 2>&1 | grep "records out" | cut -d' ' -f1)))
+		blocks=$(tar xf "$tar_file" ${board_dir}/root -O | emmc_write_blocks "$EMMC_ROOT_DEV") && [ -n "$blocks" ] ||
+			emmc_write_failed rootfs "$EMMC_ROOT_DEV" || return 1
+		export EMMC_ROOTFS_BLOCKS=$((blocks))
 		# Account for 64KiB ROOTDEV_OVERLAY_ALIGN in libfstools
 		EMMC_ROOTFS_BLOCKS=$(((EMMC_ROOTFS_BLOCKS + 127) & ~127))
 	}
@@ -38,10 +68,13 @@ emmc_upgrade_tar() {
 
 emmc_upgrade_fit() {
 	local fit_file="$1"
+	local blocks
 	[ "$CI_KERNPART" -a -z "$EMMC_KERN_DEV" ] && export EMMC_KERN_DEV="$(find_mmc_part $CI_KERNPART $CI_ROOTDEV)"
 
 	if [ "$EMMC_KERN_DEV" ]; then
-		export EMMC_KERNEL_BLOCKS=$(($(get_image "$fit_file" | fwtool -i /dev/null -T - | dd of="$EMMC_KERN_DEV" bs=512 2>&1 | grep "records out" | cut -d' ' -f1)))
+		blocks=$(get_image "$fit_file" | fwtool -i /dev/null -T - | emmc_write_blocks "$EMMC_KERN_DEV") && [ -n "$blocks" ] ||
+			emmc_write_failed image "$EMMC_KERN_DEV" || return 1
+		export EMMC_KERNEL_BLOCKS=$((blocks))
 
 		[ -z "$UPGRADE_BACKUP" ] && dd if=/dev/zero of="$EMMC_KERN_DEV" bs=512 seek=$EMMC_KERNEL_BLOCKS count=8
 	fi
@@ -49,11 +82,11 @@ emmc_upgrade_fit() {
 
 emmc_copy_config() {
 	if [ "$EMMC_DATA_DEV" ]; then
-		dd if="$UPGRADE_BACKUP" of="$EMMC_DATA_DEV" bs=512
+		emmc_write_blocks "$EMMC_DATA_DEV" < "$UPGRADE_BACKUP" > /dev/null
 	elif [ "$EMMC_ROOTFS_BLOCKS" ]; then
-		dd if="$UPGRADE_BACKUP" of="$EMMC_ROOT_DEV" bs=512 seek=$EMMC_ROOTFS_BLOCKS
+		emmc_write_blocks "$EMMC_ROOT_DEV" $EMMC_ROOTFS_BLOCKS < "$UPGRADE_BACKUP" > /dev/null
 	elif [ "$EMMC_KERNEL_BLOCKS" ]; then
-		dd if="$UPGRADE_BACKUP" of="$EMMC_KERN_DEV" bs=512 seek=$EMMC_KERNEL_BLOCKS
+		emmc_write_blocks "$EMMC_KERN_DEV" $EMMC_KERNEL_BLOCKS < "$UPGRADE_BACKUP" > /dev/null
 	fi
 }
 
@@ -96,6 +96,17 @@ identify_tar() {
 	identify_magic $(get_magic_long_tar "$1" "$2")
 }
 
+# List "size name" for every member of a tar, sizes come from the headers
+# so the member data is skipped rather than extracted
+nand_tar_list() {
+	tar tvf "$1" 2>/dev/null | awk '{ print $3, $NF }'
+}
+
+# Size of member $2 in a listing from nand_tar_list, empty if not present
+nand_tar_member_size() {
+	echo "$1" | awk -v name="$2" '$2 == name { print $1; exit }'
+}
+
 nand_restore_config() {
 	sync
 	local ubidev=$( nand_find_ubi $CI_UBIPART )
@@ -277,18 +288,20 @@ nand_upgrade_fit() {
 nand_upgrade_tar() {
 	local tar_file="$1"
 	local kernel_mtd="$(find_mtd_index $CI_KERNPART)"
+	local tar_list="$(nand_tar_list "$tar_file")"
 
-	local board_dir=$(tar tf "$tar_file" | grep -m 1 '^sysupgrade-.*/$')
+	local board_dir=$(echo "$tar_list" | awk '$2 ~ /^sysupgrade-.*\/$/ { print $2; exit }')
 	board_dir=${board_dir%/}
 
-	kernel_length=$( (tar xf "$tar_file" ${board_dir}/kernel -O | wc -c) 2> /dev/null)
+	kernel_length=$(nand_tar_member_size "$tar_list" ${board_dir}/kernel)
+	kernel_length=${kernel_length:-0}
 	local has_rootfs=0
 	local rootfs_length
 	local rootfs_type
 
-	tar tf "$tar_file" ${board_dir}/root 1>/dev/null 2>/dev/null && has_rootfs=1
+	rootfs_length=$(nand_tar_member_size "$tar_list" ${board_dir}/root)
+	[ -n "$rootfs_length" ] && has_rootfs=1
 	[ "$has_rootfs" = "1" ] && {
-		rootfs_length=$( (tar xf "$tar_file" ${board_dir}/root -O | wc -c) 2> /dev/null)
 		rootfs_type="$(identify_tar "$tar_file" ${board_dir}/root)"
 	}
 
@@ -210,6 +210,7 @@ struct atm_priv_data {
 
 	volatile struct rx_descriptor *aal_desc;
 	unsigned int aal_desc_pos;
+	int aal_rx_more;
 
 	volatile struct rx_descriptor *oam_desc;
 	unsigned char *oam_buf;
@@ -108,6 +108,10 @@ static int dma_tx_descriptor_length = 64;       /*  Number of descriptors per DM
   \brief PPE core clock cycles between descriptor write and effectiveness in external RAM
  */
 static int dma_rx_clp1_descriptor_threshold = 38;
+/*!
+  \brief Max number of AAL5 RX descriptors handled per tasklet run
+ */
+static int dma_rx_budget = 32;                  /*  Max AAL5 RX descriptors per tasklet run         */
 /*@}*/
 
 MODULE_PARM(qsb_tau, "i");
@@ -139,6 +143,8 @@ MODULE_PARM(dma_tx_descriptor_length, "i");
 MODULE_PARM_DESC(dma_tx_descriptor_length, "Number of descriptor assigned to DMA TX channel (>16)");
 MODULE_PARM(dma_rx_clp1_descriptor_threshold, "i");
 MODULE_PARM_DESC(dma_rx_clp1_descriptor_threshold, "Descriptor threshold for cells with cell loss priority 1");
+MODULE_PARM(dma_rx_budget, "i");
+MODULE_PARM_DESC(dma_rx_budget, "Max number of AAL5 RX descriptors handled before other work may run");
 
 
 
@@ -196,7 +202,7 @@ static inline int get_tx_desc(unsigned int);
  *  mailbox handler and signal function
  */
 static inline void mailbox_oam_rx_handler(void);
-static inline void mailbox_aal_rx_handler(void);
+static inline int mailbox_aal_rx_handler(unsigned int);
 static irqreturn_t mailbox_irq_handler(int, void *);
 static inline void mailbox_signal(unsigned int, int);
 static void do_ppe_tasklet(unsigned long);
@@ -428,6 +434,7 @@ static int ppe_open(struct atm_vcc *vcc)
 	vcc->itf = (int)vcc->dev->dev_data;
 	vcc->vpi = vpi;
 	vcc->vci = vci;
+	vcc->dev_data = &g_atm_priv_data.conn[conn];
 	set_bit(ATM_VF_READY, &vcc->flags);
 
 	/*  enable irq  */
@@ -474,6 +481,7 @@ static void ppe_close(struct atm_vcc *vcc)
 	clear_htu_entry(conn);
 
 	/*  release connection  */
+	vcc->dev_data = NULL;
 	connection->vcc = NULL;
 	connection->aal5_vcc_crc_err = 0;
 	connection->aal5_vcc_oversize_sdu = 0;
@@ -911,7 +919,7 @@ static inline void mailbox_oam_rx_handler(void)
 	}
 }
 
-static inline void mailbox_aal_rx_handler(void)
+static inline int mailbox_aal_rx_handler(unsigned int budget)
 {
 	unsigned int vlddes = WRX_DMA_CHANNEL_CONFIG(RX_DMA_CH_AAL)->vlddes;
 	struct rx_descriptor reg_desc;
@@ -921,7 +929,7 @@ static inline void mailbox_aal_rx_handler(void)
 	struct rx_inband_trailer *trailer;
 	unsigned int i;
 
-	for ( i = 0; i < vlddes; i++ ) {
+	for ( i = 0; i < vlddes && i < budget; i++ ) {
 		unsigned int loop_count = 0;
 
 		do {
@@ -1001,6 +1009,9 @@ static inline void mailbox_aal_rx_handler(void)
 
 		mailbox_signal(RX_DMA_CH_AAL, 0);
 	}
+
+	/*  more descriptors are ready than the budget allowed  */
+	return vlddes > budget;
 }
 
 static void do_ppe_tasklet(unsigned long data)
@@ -1008,8 +1019,9 @@ static void do_ppe_tasklet(unsigned long data)
 	unsigned int irqs = *MBOX_IGU1_ISR;
 	*MBOX_IGU1_ISRC = *MBOX_IGU1_ISR;
 
-	if (irqs & (1 << RX_DMA_CH_AAL))
-		mailbox_aal_rx_handler();
+	/* the interrupt was already acked when the budget ran out last time */
+	if ((irqs & (1 << RX_DMA_CH_AAL)) || g_atm_priv_data.aal_rx_more)
+		g_atm_priv_data.aal_rx_more = mailbox_aal_rx_handler(dma_rx_budget);
 	if (irqs & (1 << RX_DMA_CH_OAM))
 		mailbox_oam_rx_handler();
 
@@ -1017,7 +1029,9 @@ static void do_ppe_tasklet(unsigned long data)
 	if ((irqs >> (FIRST_QSB_QID + 16)) & g_atm_priv_data.conn_table)
 		mailbox_tx_handler(irqs >> (FIRST_QSB_QID + 16));
 
-	if ((*MBOX_IGU1_ISR & ((1 << RX_DMA_CH_AAL) | (1 << RX_DMA_CH_OAM))) != 0)
+	if (g_atm_priv_data.aal_rx_more)
+		tasklet_schedule(&g_dma_tasklet);
+	else if ((*MBOX_IGU1_ISR & ((1 << RX_DMA_CH_AAL) | (1 << RX_DMA_CH_OAM))) != 0)
 		tasklet_schedule(&g_dma_tasklet);
 	else if (*MBOX_IGU1_ISR >> (FIRST_QSB_QID + 16)) /* TX queue */
 		tasklet_schedule(&g_dma_tasklet);
@@ -1306,16 +1320,20 @@ static inline int find_vpivci(unsigned int vpi, unsigned int vci)
 
 static inline int find_vcc(struct atm_vcc *vcc)
 {
+	struct connection *connection = vcc->dev_data;
 	int i;
-	unsigned int bit;
 
-	for ( i = 0, bit = 1; i < MAX_PVC_NUMBER; i++, bit <<= 1 ) {
-		if ( (g_atm_priv_data.conn_table & bit) != 0
-			&& g_atm_priv_data.conn[i].vcc == vcc )
-		return i;
-	}
+	/*  set by ppe_open, saves a scan on every send  */
+	if ( connection == NULL )
+		return -1;
 
-	return -1;
+	i = connection - g_atm_priv_data.conn;
+	if ( i < 0 || i >= MAX_PVC_NUMBER
+		|| !test_bit(i, &g_atm_priv_data.conn_table)
+		|| connection->vcc != vcc )
+		return -1;
+
+	return i;
 }
 
 static inline int ifx_atm_version(const struct ltq_atm_ops *ops, char *buf)
@@ -1376,6 +1394,8 @@ static inline void check_parameters(void)
 
 	if ( dma_rx_descriptor_length < 2 )
 		dma_rx_descriptor_length = 2;
+	if ( dma_rx_budget < 1 )
+		dma_rx_budget = 1;
 	if ( dma_tx_descriptor_length < 2 )
 		dma_tx_descriptor_length = 2;
 	if ( dma_rx_clp1_descriptor_threshold < 0 )
@@ -97,6 +97,8 @@ spinlock_t aes_lock;
 #define CTR_RFC3686_MIN_KEY_SIZE  (AES_MIN_KEY_SIZE + CTR_RFC3686_NONCE_SIZE)
 #define CTR_RFC3686_MAX_KEY_SIZE  (AES_MAX_KEY_SIZE + CTR_RFC3686_NONCE_SIZE)
 #define AES_CBCMAC_DBN_TEMP_SIZE  128
+/* blocks fed to the engine per critical section, bounds the IRQ-off time */
+#define AES_LOCK_BLOCKS     16
 
 #ifdef CRYPTO_DEBUG
 extern char debug_level;
@@ -239,6 +241,46 @@ void aes_set_key_hw (void *ctx_arg)
 }
 
 
+/*! \fn static void aes_relock_hw (void *ctx_arg, u8 *iv_arg, int encdec, int mode, unsigned long *flag)
+ *  \ingroup IFX_AES_FUNCTIONS
+ *  \brief briefly drops the AES lock in the middle of a request, requires spinlock to be set by caller
+ *  \param ctx_arg crypto algo context
+ *  \param iv_arg initialization vector, NULL if the caller reloads it per block
+ *  \param encdec 1 for encrypt; 0 for decrypt
+ *  \param mode operation mode such as ebc, cbc, ctr
+ *  \param flag saved irq flags of the caller
+ *
+ *  Other users may program the engine while the lock is released, so the
+ *  chaining value is saved first and key, mode and IV are loaded again.
+*/
+static void aes_relock_hw (void *ctx_arg, u8 *iv_arg, int encdec, int mode,
+        unsigned long *flag)
+{
+    volatile struct aes_t *aes = (volatile struct aes_t *) AES_START;
+
+    if (iv_arg) {
+        *((u32 *) iv_arg) = DEU_ENDIAN_SWAP(aes->IV3R);
+        *((u32 *) iv_arg + 1) = DEU_ENDIAN_SWAP(aes->IV2R);
+        *((u32 *) iv_arg + 2) = DEU_ENDIAN_SWAP(aes->IV1R);
+        *((u32 *) iv_arg + 3) = DEU_ENDIAN_SWAP(aes->IV0R);
+    }
+
+    spin_unlock_irqrestore(&aes_lock, *flag);
+    spin_lock_irqsave(&aes_lock, *flag);
+
+    aes_set_key_hw (ctx_arg);
+
+    aes->controlr.E_D = !encdec;
+    aes->controlr.O = mode;
+
+    if (iv_arg) {
+        aes->IV3R = DEU_ENDIAN_SWAP(*(u32 *) iv_arg);
+        aes->IV2R = DEU_ENDIAN_SWAP(*((u32 *) iv_arg + 1));
+        aes->IV1R = DEU_ENDIAN_SWAP(*((u32 *) iv_arg + 2));
+        aes->IV0R = DEU_ENDIAN_SWAP(*((u32 *) iv_arg + 3));
+    }
+}
+
 /*! \fn void ifx_deu_aes (void *ctx_arg, u8 *out_arg, const u8 *in_arg, u8 *iv_arg, size_t nbytes, int encdec, int mode)
  *  \ingroup IFX_AES_FUNCTIONS
  *  \brief main interface to AES hardware
@@ -262,6 +304,7 @@ void ifx_deu_aes (void *ctx_arg, u8 *out_arg, const u8 *in_arg,
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
     int i = 0;
     int byte_cnt = nbytes; 
+    int burst = 0;
 
     CRTCL_SECT_START;
 
@@ -298,6 +341,12 @@ void ifx_deu_aes (void *ctx_arg, u8 *out_arg, const u8 *in_arg,
 
         i++;
         byte_cnt -= 16;
+
+        /* let pending interrupts in every few blocks */
+        if (++burst == AES_LOCK_BLOCKS && byte_cnt > 0) {
+            aes_relock_hw (ctx_arg, mode > 0 ? iv_arg : NULL, encdec, mode, &flag);
+            burst = 0;
+        }
     }
 
     /* To handle all non-aligned bytes (not aligned to 16B size) */
@@ -705,6 +754,7 @@ void ifx_deu_aes_xts (void *ctx_arg, u8 *out_arg, const u8 *in_arg,
     u8 oldiv[16];
     int i = 0;
     int byte_cnt = nbytes; 
+    int burst = 0;
 
     CRTCL_SECT_START;
 
@@ -749,6 +799,12 @@ void ifx_deu_aes_xts (void *ctx_arg, u8 *out_arg, const u8 *in_arg,
         gf128mul_x_ble((le128 *)iv_arg, (le128 *)iv_arg);
         i++;
         byte_cnt -= 16;
+
+        /* IV is loaded per block here, only key and mode need restoring */
+        if (++burst == AES_LOCK_BLOCKS && byte_cnt > 0) {
+            aes_relock_hw (ctx_arg, NULL, encdec, 1, &flag);
+            burst = 0;
+        }
     }
 
     if (byte_cnt) {
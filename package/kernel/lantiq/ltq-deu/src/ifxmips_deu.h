@@ -135,6 +135,8 @@ extern spinlock_t ltq_deu_hash_lock;
 #define CRTCL_SECT_HASH_INIT        spin_lock_init(&ltq_deu_hash_lock)
 #define CRTCL_SECT_HASH_START       spin_lock_irqsave(&ltq_deu_hash_lock, flag)
 #define CRTCL_SECT_HASH_END         spin_unlock_irqrestore(&ltq_deu_hash_lock, flag)
+/* 64-byte blocks hashed per critical section, bounds the IRQ-off time */
+#define HASH_LOCK_BLOCKS            16
 
 
 #define DEU_WAKELIST_INIT(queue) \
@@ -81,47 +81,55 @@ struct md5_ctx {
 
 extern int disable_deudma;
 
-/*! \fn static void md5_transform(u32 *hash, u32 const *in)
+/*! \fn static void md5_transform(struct md5_ctx *mctx, u32 *hash, u32 const *in, unsigned int blocks)
  *  \ingroup IFX_MD5_FUNCTIONS
  *  \brief main interface to md5 hardware   
  *  \param hash current hash value  
- *  \param in 64-byte block of input  
+ *  \param in 64-byte blocks of input  
+ *  \param blocks number of blocks in input  
 */                                 
-static void md5_transform(struct md5_ctx *mctx, u32 *hash, u32 const *in)
+static void md5_transform(struct md5_ctx *mctx, u32 *hash, u32 const *in,
+            unsigned int blocks)
 {
     int i;
     volatile struct deu_hash_t *hashs = (struct deu_hash_t *) HASH_START;
     unsigned long flag;
+    unsigned int burst;
 
-    CRTCL_SECT_HASH_START;
+    while (blocks) {
+        CRTCL_SECT_HASH_START;
 
-    MD5_HASH_INIT;
+        MD5_HASH_INIT;
 
-    if (mctx->started) { 
-        hashs->D1R = *((u32 *) hash + 0);
-        hashs->D2R = *((u32 *) hash + 1);
-        hashs->D3R = *((u32 *) hash + 2);
-        hashs->D4R = *((u32 *) hash + 3);
-    }
+        if (mctx->started) { 
+            hashs->D1R = *((u32 *) hash + 0);
+            hashs->D2R = *((u32 *) hash + 1);
+            hashs->D3R = *((u32 *) hash + 2);
+            hashs->D4R = *((u32 *) hash + 3);
+        }
 
-    for (i = 0; i < 16; i++) {
-        hashs->MR = in[i];
-//      printk("in[%d]: %08x\n", i, in[i]);
-    };
+        /* the state stays in the engine from one block to the next */
+        for (burst = 0; blocks && burst < HASH_LOCK_BLOCKS; burst++, blocks--) {
+            for (i = 0; i < 16; i++) {
+                hashs->MR = in[i];
+            };
+            in += 16;
 
-    //wait for processing
-    while (hashs->controlr.BSY) {
-        // this will not take long
-    }
+            //wait for processing
+            while (hashs->controlr.BSY) {
+                // this will not take long
+            }
+        }
 
-    *((u32 *) hash + 0) = hashs->D1R;
-    *((u32 *) hash + 1) = hashs->D2R;
-    *((u32 *) hash + 2) = hashs->D3R;
-    *((u32 *) hash + 3) = hashs->D4R;
+        *((u32 *) hash + 0) = hashs->D1R;
+        *((u32 *) hash + 1) = hashs->D2R;
+        *((u32 *) hash + 2) = hashs->D3R;
+        *((u32 *) hash + 3) = hashs->D4R;
 
-    CRTCL_SECT_HASH_END;
+        CRTCL_SECT_HASH_END;
 
-    mctx->started = 1;
+        mctx->started = 1;
+    }
 }
 
 /*! \fn static inline void md5_transform_helper(struct md5_ctx *ctx)
@@ -132,7 +140,7 @@ static void md5_transform(struct md5_ctx *mctx, u32 *hash, u32 const *in)
 static inline void md5_transform_helper(struct md5_ctx *ctx)
 {
     //le32_to_cpu_array(ctx->block, sizeof(ctx->block) / sizeof(u32));
-    md5_transform(ctx, ctx->hash, ctx->block);
+    md5_transform(ctx, ctx->hash, ctx->block, 1);
 }
 
 /*! \fn static void md5_init(struct crypto_tfm *tfm)
@@ -177,6 +185,15 @@ static int md5_update(struct shash_desc *desc, const u8 *data, unsigned int len)
     data += avail;
     len -= avail;
 
+    /* aligned input goes to the engine without bouncing */
+    if (len >= sizeof(mctx->block) && IS_ALIGNED((unsigned long)data, 4)) {
+        unsigned int blocks = len / sizeof(mctx->block);
+
+        md5_transform(mctx, mctx->hash, (u32 const *)data, blocks);
+        data += blocks * sizeof(mctx->block);
+        len -= blocks * sizeof(mctx->block);
+    }
+
     while (len >= sizeof(mctx->block)) {
         memcpy(mctx->block, data, sizeof(mctx->block));
         md5_transform_helper(mctx);
@@ -215,7 +232,7 @@ static int md5_final(struct shash_desc *desc, u8 *out)
     mctx->block[14] = le32_to_cpu(mctx->byte_count << 3);
     mctx->block[15] = le32_to_cpu(mctx->byte_count >> 29);
 
-    md5_transform(mctx, mctx->hash, mctx->block);                                                 
+    md5_transform(mctx, mctx->hash, mctx->block, 1);                                                 
 
     memcpy(out, mctx->hash, MD5_DIGEST_SIZE);
 
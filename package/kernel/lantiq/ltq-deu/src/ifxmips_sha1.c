@@ -85,54 +85,63 @@ struct sha1_ctx {
 
 extern int disable_deudma;
 
-/*! \fn static void sha1_transform1 (u32 *state, const u32 *in)
+/*! \fn static void sha1_transform1 (struct sha1_ctx *sctx, u32 *state, const u32 *in, unsigned int blocks)
  *  \ingroup IFX_SHA1_FUNCTIONS
  *  \brief main interface to sha1 hardware   
  *  \param state current state 
- *  \param in 64-byte block of input  
+ *  \param in 64-byte blocks of input  
+ *  \param blocks number of blocks in input  
 */                                 
-static void sha1_transform1 (struct sha1_ctx *sctx, u32 *state, const u32 *in)
+static void sha1_transform1 (struct sha1_ctx *sctx, u32 *state, const u32 *in,
+            unsigned int blocks)
 {
     int i = 0;
     volatile struct deu_hash_t *hashs = (struct deu_hash_t *) HASH_START;
     unsigned long flag;
+    unsigned int burst;
+
+    while (blocks) {
+        CRTCL_SECT_HASH_START;
+
+        SHA_HASH_INIT;
+
+        /* For context switching purposes, the previous hash output
+         * is loaded back into the output register 
+        */
+        if (sctx->started) {
+            hashs->D1R = *((u32 *) sctx->hash + 0);
+            hashs->D2R = *((u32 *) sctx->hash + 1);
+            hashs->D3R = *((u32 *) sctx->hash + 2);
+            hashs->D4R = *((u32 *) sctx->hash + 3);
+            hashs->D5R = *((u32 *) sctx->hash + 4);
+        }
 
-    CRTCL_SECT_HASH_START;
-
-    SHA_HASH_INIT;
+        /* the state stays in the engine from one block to the next */
+        for (burst = 0; blocks && burst < HASH_LOCK_BLOCKS; burst++, blocks--) {
+            for (i = 0; i < 16; i++) {
+                hashs->MR = in[i];
+            };
+            in += 16;
+
+            //wait for processing
+            while (hashs->controlr.BSY) {
+                // this will not take long
+            }
+        }
 
-    /* For context switching purposes, the previous hash output
-     * is loaded back into the output register 
-    */
-    if (sctx->started) {
-        hashs->D1R = *((u32 *) sctx->hash + 0);
-        hashs->D2R = *((u32 *) sctx->hash + 1);
-        hashs->D3R = *((u32 *) sctx->hash + 2);
-        hashs->D4R = *((u32 *) sctx->hash + 3);
-        hashs->D5R = *((u32 *) sctx->hash + 4);
-    }
+        /* For context switching purposes, the output is saved into a 
+         * context struct which can be used later on 
+        */
+        *((u32 *) sctx->hash + 0) = hashs->D1R;
+        *((u32 *) sctx->hash + 1) = hashs->D2R;
+        *((u32 *) sctx->hash + 2) = hashs->D3R;
+        *((u32 *) sctx->hash + 3) = hashs->D4R;
+        *((u32 *) sctx->hash + 4) = hashs->D5R;
 
-    for (i = 0; i < 16; i++) {
-        hashs->MR = in[i];
-    };
+        sctx->started = 1;
 
-    //wait for processing
-    while (hashs->controlr.BSY) {
-        // this will not take long
+        CRTCL_SECT_HASH_END;
     }
-   
-    /* For context switching purposes, the output is saved into a 
-     * context struct which can be used later on 
-    */
-    *((u32 *) sctx->hash + 0) = hashs->D1R;
-    *((u32 *) sctx->hash + 1) = hashs->D2R;
-    *((u32 *) sctx->hash + 2) = hashs->D3R;
-    *((u32 *) sctx->hash + 3) = hashs->D4R;
-    *((u32 *) sctx->hash + 4) = hashs->D5R;
-
-    sctx->started = 1;
-
-    CRTCL_SECT_HASH_END;
 }
 
 /*! \fn static void sha1_init1(struct crypto_tfm *tfm)
@@ -167,9 +176,11 @@ static int sha1_update(struct shash_desc * desc, const u8 *data,
 
     if ((j + len) > 63) {
         memcpy (&sctx->buffer[j], data, (i = 64 - j));
-        sha1_transform1 (sctx, sctx->state, (const u32 *)sctx->buffer);
-        for (; i + 63 < len; i += 64) {
-            sha1_transform1 (sctx, sctx->state, (const u32 *)&data[i]);
+        sha1_transform1 (sctx, sctx->state, (const u32 *)sctx->buffer, 1);
+        if (i + 63 < len) {
+            sha1_transform1 (sctx, sctx->state, (const u32 *)&data[i],
+                             (len - i) / 64);
+            i += (len - i) & ~63;
         }
 
         j = 0;
@@ -87,6 +87,8 @@ static inline struct sk_buff* alloc_skb_rx(void);
 static inline struct sk_buff* alloc_skb_tx(unsigned int);
 static inline struct sk_buff *get_skb_pointer(unsigned int);
 static inline int get_tx_desc(unsigned int, unsigned int *);
+static unsigned int ptm_tx_reclaim(struct net_device *);
+static void ptm_tx_arm_irq(struct net_device *);
 
 /*
  *  Mailbox handler and signal function
@@ -151,7 +153,9 @@ static void ptm_setup(struct net_device *dev, int ndev)
     dev->netdev_ops      = &g_ptm_netdev_ops;
     /* Allow up to 1508 bytes, for RFC4638 */
     dev->max_mtu         = ETH_DATA_LEN + 8;
-    netif_napi_add(dev, &g_ptm_priv_data.itf[ndev].napi, ptm_napi_poll, 16);
+    netif_napi_add(dev, &g_ptm_priv_data.itf[ndev].napi, ptm_napi_poll, NAPI_POLL_WEIGHT);
+    /*  room for skb pointer and burst alignment, saves the copy in xmit    */
+    dev->needed_headroom = sizeof(struct sk_buff *) + DATA_BUFFER_ALIGNMENT;
     dev->watchdog_timeo  = ETH_WATCHDOG_TIMEOUT;
 
     dev->dev_addr[0] = 0x00;
@@ -181,6 +185,7 @@ static int ptm_open(struct net_device *dev)
 
     IFX_REG_W32_MASK(0, 1, MBOX_IGU1_IER);
 
+    netdev_reset_queue(dev);
     netif_start_queue(dev);
 
     return 0;
@@ -188,6 +193,9 @@ static int ptm_open(struct net_device *dev)
 
 static int ptm_stop(struct net_device *dev)
 {
+    struct ptm_itf *p_itf = &g_ptm_priv_data.itf[0];
+    int i;
+
     ASSERT(dev == g_net_dev[0], "incorrect device");
 
     IFX_REG_W32_MASK(1 | (1 << 17), 0, MBOX_IGU1_IER);
@@ -196,6 +204,15 @@ static int ptm_stop(struct net_device *dev)
 
     netif_stop_queue(dev);
 
+    //  drop the BQL state, descriptors the PPE still holds are freed
+    //  later without being accounted against the next ifup
+    netif_tx_lock_bh(dev);
+    ptm_tx_reclaim(dev);
+    for ( i = 0; i < CPU_TO_WAN_TX_DESC_NUM; i++ )
+        p_itf->tx_len[i] = 0;
+    netdev_reset_queue(dev);
+    netif_tx_unlock_bh(dev);
+
     return 0;
 }
 
@@ -256,6 +273,16 @@ static int ptm_napi_poll(struct napi_struct *napi, int budget)
 {
     int ndev = 0;
     unsigned int work_done;
+    struct netdev_queue *txq = netdev_get_tx_queue(napi->dev, 0);
+
+    //  free everything the PPE has taken off the CPU TX ring
+    __netif_tx_lock(txq, smp_processor_id());
+    ptm_tx_reclaim(napi->dev);
+    if ( netif_queue_stopped(napi->dev) && CPU_TO_WAN_TX_DESC_BASE[g_ptm_priv_data.itf[0].tx_desc_pos].own == 0 )
+        netif_wake_queue(napi->dev);
+    if ( netif_xmit_stopped(txq) )
+        ptm_tx_arm_irq(napi->dev);
+    __netif_tx_unlock(txq);
 
     work_done = ptm_poll(ndev, budget);
 
@@ -284,7 +311,7 @@ static int ptm_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
     int desc_base;
     volatile struct tx_descriptor *desc;
     struct tx_descriptor reg_desc = {0};
-    struct sk_buff *skb_to_free;
+    struct ptm_itf *p_itf = &g_ptm_priv_data.itf[0];
     unsigned int byteoff;
 
     ASSERT(dev == g_net_dev[0], "incorrect device");
@@ -294,40 +321,32 @@ static int ptm_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
         goto PTM_HARD_START_XMIT_FAIL;
     }
 
+    /*  the skb pointer is stored in front of the data, only the head must be private  */
+    byteoff = (unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1);
+    if ( skb_headroom(skb) < sizeof(struct sk_buff *) + byteoff || skb_header_cloned(skb) ) {
+        if ( skb_cow_head(skb, sizeof(struct sk_buff *) + DATA_BUFFER_ALIGNMENT) ) {
+            dbg("no memory");
+            goto ALLOC_SKB_TX_FAIL;
+        }
+        byteoff = (unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1);
+    }
+
+    //  every descriptor still holds an skb, NAPI has not caught up yet
+    if ( p_itf->tx_pending == CPU_TO_WAN_TX_DESC_NUM )
+        ptm_tx_reclaim(dev);
+
     /*  allocate descriptor */
     desc_base = get_tx_desc(0, &f_full);
     if ( f_full ) {
         netif_trans_update(dev);
         netif_stop_queue(dev);
 
-        IFX_REG_W32_MASK(0, 1 << 17, MBOX_IGU1_ISRC);
-        IFX_REG_W32_MASK(0, 1 << 17, MBOX_IGU1_IER);
+        ptm_tx_arm_irq(dev);
     }
     if ( desc_base < 0 )
         goto PTM_HARD_START_XMIT_FAIL;
     desc = &CPU_TO_WAN_TX_DESC_BASE[desc_base];
 
-    byteoff = (unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1);
-    if ( skb_headroom(skb) < sizeof(struct sk_buff *) + byteoff || skb_cloned(skb) ) {
-        struct sk_buff *new_skb;
-
-        ASSERT(skb_headroom(skb) >= sizeof(struct sk_buff *) + byteoff, "skb_headroom(skb) < sizeof(struct sk_buff *) + byteoff");
-        ASSERT(!skb_cloned(skb), "skb is cloned");
-
-        new_skb = alloc_skb_tx(skb->len);
-        if ( new_skb == NULL ) {
-            dbg("no memory");
-            goto ALLOC_SKB_TX_FAIL;
-        }
-        skb_put(new_skb, skb->len);
-        memcpy(new_skb->data, skb->data, skb->len);
-        dev_kfree_skb_any(skb);
-        skb = new_skb;
-        byteoff = (unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1);
-        /*  write back to physical memory   */
-        dma_cache_wback((unsigned long)skb->data, skb->len);
-    }
-
     /* make the skb unowned */
     skb_orphan(skb);
 
@@ -335,11 +354,6 @@ static int ptm_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
     /*  write back to physical memory   */
     dma_cache_wback((unsigned long)skb->data - byteoff - sizeof(struct sk_buff *), skb->len + byteoff + sizeof(struct sk_buff *));
 
-    /*  free previous skb   */
-    skb_to_free = get_skb_pointer(desc->dataptr);
-    if ( skb_to_free != NULL )
-        dev_kfree_skb_any(skb_to_free);
-
     /*  update descriptor   */
     reg_desc.small   = 0;
     reg_desc.dataptr = (unsigned int)skb->data & (0x0FFFFFFF ^ (DATA_BUFFER_ALIGNMENT - 1));
@@ -354,11 +368,19 @@ static int ptm_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
     g_ptm_priv_data.itf[0].stats.tx_packets++;
     g_ptm_priv_data.itf[0].stats.tx_bytes += reg_desc.datalen;
 
+    p_itf->tx_len[desc_base] = reg_desc.datalen;
+    p_itf->tx_pending++;
+
     /*  write discriptor to memory  */
     *((volatile unsigned int *)desc + 1) = *((unsigned int *)&reg_desc + 1);
     wmb();
     *(volatile unsigned int *)desc = *(unsigned int *)&reg_desc;
 
+    netdev_sent_queue(dev, reg_desc.datalen);
+    //  BQL may have stopped the queue, only a reclaim can restart it
+    if ( !f_full && netif_xmit_stopped(netdev_get_tx_queue(dev, 0)) )
+        ptm_tx_arm_irq(dev);
+
     netif_trans_update(dev);
 
     return 0;
@@ -533,6 +555,51 @@ static inline struct sk_buff *get_skb_pointer(unsigned int dataptr)
     return skb;
 }
 
+static unsigned int ptm_tx_reclaim(struct net_device *dev)
+{
+    struct ptm_itf *p_itf = &g_ptm_priv_data.itf[0];
+    volatile struct tx_descriptor *desc;
+    struct sk_buff *skb;
+    unsigned int pkts = 0, bytes = 0;
+
+    //  caller holds TX lock
+
+    while ( p_itf->tx_pending ) {
+        desc = &CPU_TO_WAN_TX_DESC_BASE[p_itf->tx_reclaim_pos];
+        if ( desc->own )    //  PP32 still holds descriptor
+            break;
+
+        skb = get_skb_pointer(desc->dataptr);
+        if ( skb != NULL )
+            dev_kfree_skb_any(skb);
+        desc->dataptr = 0;
+
+        bytes += p_itf->tx_len[p_itf->tx_reclaim_pos];
+        pkts++;
+
+        p_itf->tx_pending--;
+        if ( ++p_itf->tx_reclaim_pos == CPU_TO_WAN_TX_DESC_NUM )
+            p_itf->tx_reclaim_pos = 0;
+    }
+
+    if ( pkts )
+        netdev_completed_queue(dev, pkts, bytes);
+
+    return pkts;
+}
+
+static void ptm_tx_arm_irq(struct net_device *dev)
+{
+    struct ptm_itf *p_itf = &g_ptm_priv_data.itf[0];
+
+    IFX_REG_W32_MASK(0, 1 << 17, MBOX_IGU1_ISRC);
+    IFX_REG_W32_MASK(0, 1 << 17, MBOX_IGU1_IER);
+
+    //  PPE may have released the descriptor before the interrupt was armed
+    if ( p_itf->tx_pending && CPU_TO_WAN_TX_DESC_BASE[p_itf->tx_reclaim_pos].own == 0 )
+        napi_schedule(&p_itf->napi);
+}
+
 static inline int get_tx_desc(unsigned int itf, unsigned int *f_full)
 {
     int desc_base = -1;
@@ -582,7 +649,7 @@ static irqreturn_t mailbox_irq_handler(int irq, void *dev_id)
             }
 	    if (isr & BIT(17)) {
                 IFX_REG_W32_MASK(1 << 17, 0, MBOX_IGU1_IER);
-                netif_wake_queue(g_net_dev[0]);
+                napi_schedule(&g_ptm_priv_data.itf[0].napi);
         	}
 
     return IRQ_HANDLED;
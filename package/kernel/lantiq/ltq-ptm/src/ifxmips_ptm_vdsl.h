@@ -89,6 +89,9 @@ struct ptm_itf {
     unsigned int                    rx_desc_pos;
 
     unsigned int                    tx_desc_pos;
+    unsigned int                    tx_reclaim_pos;
+    unsigned int                    tx_pending;
+    unsigned int                    tx_len[CPU_TO_WAN_TX_DESC_NUM];
 
     unsigned int                    tx_swap_desc_pos;
 
@@ -19,6 +19,8 @@
 #include <linux/netdevice.h>
 #include <linux/rtnetlink.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/u64_stats_sync.h>
 
 #define trelay_log(loglevel, tr, fmt, ...) \
 	printk(loglevel "trelay: %s <-> %s: " fmt "\n", \
@@ -27,9 +29,26 @@
 static LIST_HEAD(trelay_devs);
 static struct dentry *debugfs_dir;
 
+struct trelay_stats {
+	u64 rx_packets;
+	u64 rx_bytes;
+	u64 tx_packets;
+	u64 tx_bytes;
+	u64 tx_dropped;
+	struct u64_stats_sync syncp;
+};
+
+/* one relay direction, stored as rx_handler_data of the ingress device */
+struct trelay_port {
+	struct trelay *tr;
+	struct net_device *dev, *peer;
+	struct trelay_stats __percpu *stats;
+};
+
 struct trelay {
 	struct list_head list;
 	struct net_device *dev1, *dev2;
+	struct trelay_port port[2];
 	struct dentry *debugfs;
 	int to_remove;
 	char name[];
@@ -37,24 +56,90 @@ struct trelay {
 
 rx_handler_result_t trelay_handle_frame(struct sk_buff **pskb)
 {
-	struct net_device *dev;
+	struct trelay_port *port;
+	struct trelay_stats *stats;
 	struct sk_buff *skb = *pskb;
+	unsigned int len;
+	int ret;
 
-	dev = rcu_dereference(skb->dev->rx_handler_data);
-	if (!dev)
+	port = rcu_dereference(skb->dev->rx_handler_data);
+	if (!port)
 		return RX_HANDLER_PASS;
 
 	if (skb->protocol == htons(ETH_P_PAE))
 		return RX_HANDLER_PASS;
 
 	skb_push(skb, ETH_HLEN);
-	skb->dev = dev;
+	skb->dev = port->peer;
 	skb_forward_csum(skb);
-	dev_queue_xmit(skb);
+
+	/* GRO aggregates are passed on as-is, the core segments them in
+	 * validate_xmit_skb() only if the peer cannot take GSO frames */
+	len = skb->len;
+	ret = dev_queue_xmit(skb);
+
+	stats = this_cpu_ptr(port->stats);
+	u64_stats_update_begin(&stats->syncp);
+	stats->rx_packets++;
+	stats->rx_bytes += len;
+	if (net_xmit_eval(ret) == 0) {
+		stats->tx_packets++;
+		stats->tx_bytes += len;
+	} else {
+		stats->tx_dropped++;
+	}
+	u64_stats_update_end(&stats->syncp);
 
 	return RX_HANDLER_CONSUMED;
 }
 
+static void trelay_port_stats(struct trelay_port *port, struct trelay_stats *sum)
+{
+	int cpu;
+
+	memset(sum, 0, sizeof(*sum));
+
+	for_each_possible_cpu(cpu) {
+		struct trelay_stats *stats = per_cpu_ptr(port->stats, cpu);
+		u64 rx_packets, rx_bytes, tx_packets, tx_bytes, tx_dropped;
+		unsigned int start;
+
+		do {
+			start = u64_stats_fetch_begin_irq(&stats->syncp);
+			rx_packets = stats->rx_packets;
+			rx_bytes = stats->rx_bytes;
+			tx_packets = stats->tx_packets;
+			tx_bytes = stats->tx_bytes;
+			tx_dropped = stats->tx_dropped;
+		} while (u64_stats_fetch_retry_irq(&stats->syncp, start));
+
+		sum->rx_packets += rx_packets;
+		sum->rx_bytes += rx_bytes;
+		sum->tx_packets += tx_packets;
+		sum->tx_bytes += tx_bytes;
+		sum->tx_dropped += tx_dropped;
+	}
+}
+
+static int trelay_stats_show(struct seq_file *s, void *unused)
+{
+	struct trelay *tr = s->private;
+	struct trelay_stats sum;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(tr->port); i++) {
+		trelay_port_stats(&tr->port[i], &sum);
+		seq_printf(s, "%s -> %s: rx %llu packets %llu bytes, "
+			   "tx %llu packets %llu bytes, dropped %llu\n",
+			   tr->port[i].dev->name, tr->port[i].peer->name,
+			   sum.rx_packets, sum.rx_bytes,
+			   sum.tx_packets, sum.tx_bytes, sum.tx_dropped);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(trelay_stats);
+
 static int trelay_open(struct inode *inode, struct file *file)
 {
 	file->private_data = inode->i_private;
@@ -77,6 +162,8 @@ static int trelay_do_remove(struct trelay *tr)
 
 	trelay_log(KERN_INFO, tr, "stopped");
 
+	free_percpu(tr->port[0].stats);
+	free_percpu(tr->port[1].stats);
 	kfree(tr);
 
 	return 0;
@@ -84,13 +171,15 @@ static int trelay_do_remove(struct trelay *tr)
 
 static struct trelay *trelay_find(struct net_device *dev)
 {
-	struct trelay *tr;
+	struct trelay_port *port;
 
-	list_for_each_entry(tr, &trelay_devs, list) {
-		if (tr->dev1 == dev || tr->dev2 == dev)
-			return tr;
-	}
-	return NULL;
+	/* the relay is reachable from the device itself, no list walk */
+	if (rcu_access_pointer(dev->rx_handler) != trelay_handle_frame)
+		return NULL;
+
+	port = rtnl_dereference(dev->rx_handler_data);
+
+	return port ? port->tr : NULL;
 }
 
 static int tr_device_event(struct notifier_block *unused, unsigned long event,
@@ -156,6 +245,15 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 	if (!tr)
 		return -ENOMEM;
 
+	tr->port[0].stats = netdev_alloc_pcpu_stats(struct trelay_stats);
+	tr->port[1].stats = netdev_alloc_pcpu_stats(struct trelay_stats);
+	if (!tr->port[0].stats || !tr->port[1].stats) {
+		free_percpu(tr->port[0].stats);
+		free_percpu(tr->port[1].stats);
+		kfree(tr);
+		return -ENOMEM;
+	}
+
 	rtnl_lock();
 	rcu_read_lock();
 
@@ -171,11 +269,18 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 	if (!dev1 || !dev2)
 		goto out;
 
-	ret = netdev_rx_handler_register(dev1, trelay_handle_frame, dev2);
+	tr->port[0].tr = tr;
+	tr->port[0].dev = dev1;
+	tr->port[0].peer = dev2;
+	tr->port[1].tr = tr;
+	tr->port[1].dev = dev2;
+	tr->port[1].peer = dev1;
+
+	ret = netdev_rx_handler_register(dev1, trelay_handle_frame, &tr->port[0]);
 	if (ret < 0)
 		goto out;
 
-	ret = netdev_rx_handler_register(dev2, trelay_handle_frame, dev1);
+	ret = netdev_rx_handler_register(dev2, trelay_handle_frame, &tr->port[1]);
 	if (ret < 0) {
 		netdev_rx_handler_unregister(dev1);
 		goto out;
@@ -193,13 +298,17 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 
 	tr->debugfs = debugfs_create_dir(name, debugfs_dir);
 	debugfs_create_file("remove", S_IWUSR, tr->debugfs, tr, &fops_remove);
+	debugfs_create_file("stats", S_IRUSR, tr->debugfs, tr, &trelay_stats_fops);
 	ret = 0;
 
 out:
 	rcu_read_unlock();
 	rtnl_unlock();
-	if (ret < 0)
+	if (ret < 0) {
+		free_percpu(tr->port[0].stats);
+		free_percpu(tr->port[1].stats);
 		kfree(tr);
+	}
 
 	return ret;
 }
@@ -34,33 +34,38 @@
 /* some programs like php need this */
 int _libiconv_version = _LIBICONV_VERSION;
 
-/* these must match the constants above */
-static const unsigned char charsets[] =
-	"\005" "UTF-8"      "\0"
-	"\004" "WCHAR_T"    "\0"
-	"\000" "UTF-16BE"   "\0"
-	"\001" "UTF-16LE"   "\0"
-	"\002" "UTF-32BE"   "\0"
-	"\003" "UTF-32LE"   "\0"
-	"\006" "ASCII"      "\0"
-	"\006" "US-ASCII"   "\0"
-	"\006" "ISO646-US"  "\0"
-	"\006" "ISO_646.IRV:1991"  "\0"
-	"\006" "ISO-IR-6"   "\0"
-	"\006" "ANSI_X3.4-1968"    "\0"
-	"\006" "ANSI_X3.4-1986"    "\0"
-	"\006" "CP367"      "\0"
-	"\006" "IBM367"     "\0"
-	"\006" "US"         "\0"
-	"\006" "CSASCII"    "\0"
-	"\007" "ISO-8859-1" "\0"
-	"\007" "LATIN1"     "\0"
-	"\010" "ISO-8859-15""\0"
-	"\010" "LATIN9"     "\0"
-	"\011" "ISO-8859-11""\0"
-	"\011" "TIS-620"    "\0"
-	"\012" "JIS-0201"   "\0"
-	"\377";
+struct charset {
+	const char name[17];
+	unsigned char id;
+};
+
+/* must be kept sorted case-insensitively, find_charset() does a binary search */
+static const struct charset charsets[] = {
+	{ "ANSI_X3.4-1968",   US_ASCII },
+	{ "ANSI_X3.4-1986",   US_ASCII },
+	{ "ASCII",            US_ASCII },
+	{ "CP367",            US_ASCII },
+	{ "CSASCII",          US_ASCII },
+	{ "IBM367",           US_ASCII },
+	{ "ISO-8859-1",       LATIN_1  },
+	{ "ISO-8859-11",      TIS_620  },
+	{ "ISO-8859-15",      LATIN_9  },
+	{ "ISO-IR-6",         US_ASCII },
+	{ "ISO646-US",        US_ASCII },
+	{ "ISO_646.IRV:1991", US_ASCII },
+	{ "JIS-0201",         JIS_0201 },
+	{ "LATIN1",           LATIN_1  },
+	{ "LATIN9",           LATIN_9  },
+	{ "TIS-620",          TIS_620  },
+	{ "US",               US_ASCII },
+	{ "US-ASCII",         US_ASCII },
+	{ "UTF-16BE",         UTF_16BE },
+	{ "UTF-16LE",         UTF_16LE },
+	{ "UTF-32BE",         UTF_32BE },
+	{ "UTF-32LE",         UTF_32LE },
+	{ "UTF-8",            UTF_8    },
+	{ "WCHAR_T",          WCHAR_T  },
+};
 
 /* separate identifiers for sbcs/dbcs/etc map type */
 #define UCS2_8BIT   000
@@ -87,20 +92,130 @@ static const unsigned short maplen[] = {
 	[EUC_TW]    = 4+ 2* 2*94*94,
 };
 
+static inline wchar_t get_16(const unsigned char *s, int endian)
+{
+	endian &= 1;
+	return s[endian]<<8 | s[endian^1];
+}
+
+static inline void put_16(unsigned char *s, wchar_t c, int endian)
+{
+	endian &= 1;
+	s[endian] = c>>8;
+	s[endian^1] = c;
+}
+
+#define N_CHARMAPS  (sizeof(charmaps) / sizeof(charmaps[0]))
+
+/* charmap index as dest charset, stored in the "to" bits of iconv_t */
+#define TO_CHARMAP  0100
+
+/* reverse lookup table for UCS2_8BIT charmaps, sorted by code point */
+struct revmap {
+	unsigned char len;
+	struct {
+		unsigned short ucs;
+		unsigned char c;
+	} ent[128];
+};
+
+/* built on first use and kept for the lifetime of the process */
+static struct revmap *revmaps[N_CHARMAPS];
+
 static int find_charmap(const char *name)
 {
-	int i;
-	for (i = 0; i < (sizeof(charmaps) / sizeof(charmaps[0])); i++)
-		if (!strcasecmp(charmaps[i].name, name))
-			return i;
+	int lo = 0, hi = N_CHARMAPS - 1, mid, cmp;
+
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		cmp = strcasecmp(name, charmaps[mid].name);
+
+		if (!cmp)
+			return mid;
+		else if (cmp < 0)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
+
 	return -1;
 }
 
 static int find_charset(const char *name)
 {
-	const unsigned char *s;
-	for (s=charsets; *s<0xff && strcasecmp(s+1, name); s+=strlen(s)+1);
-	return *s;
+	int lo = 0, hi = sizeof(charsets) / sizeof(charsets[0]) - 1, mid, cmp;
+
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		cmp = strcasecmp(name, charsets[mid].name);
+
+		if (!cmp)
+			return charsets[mid].id;
+		else if (cmp < 0)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
+
+	return 255;
+}
+
+static struct revmap *get_revmap(int m)
+{
+	const unsigned char *map = charmaps[m].map;
+	struct revmap *r;
+	wchar_t c;
+	int i, j;
+
+	if (revmaps[m])
+		return revmaps[m];
+
+	if (map[0] != UCS2_8BIT)
+		return NULL;
+
+	r = calloc(1, sizeof(*r));
+
+	if (!r)
+		return NULL;
+
+	/* insertion sort, the charmap tables are mostly ascending already */
+	for (i = 0; i < 128; i++) {
+		c = get_16(map + 4 + 2*i, 0);
+
+		if (c == 0xffff)
+			continue;
+
+		for (j = r->len; j > 0 && r->ent[j-1].ucs > c; j--)
+			r->ent[j] = r->ent[j-1];
+
+		r->ent[j].ucs = c;
+		r->ent[j].c = 0x80 + i;
+		r->len++;
+	}
+
+	/* concurrent first use may build the table twice, both copies are
+	 * identical so the loser is simply leaked */
+	revmaps[m] = r;
+
+	return r;
+}
+
+static int revmap_lookup(const struct revmap *r, wchar_t c)
+{
+	int lo = 0, hi = r->len - 1, mid;
+
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+
+		if (r->ent[mid].ucs == c)
+			return r->ent[mid].c;
+		else if (r->ent[mid].ucs > c)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
+
+	return -1;
 }
 
 iconv_t iconv_open(const char *to, const char *from)
@@ -108,8 +223,12 @@ iconv_t iconv_open(const char *to, const char *from)
 	unsigned f, t;
 	int m;
 
-	if ((t = find_charset(to)) > 8)
-		return -1;
+	if ((t = find_charset(to)) > 8) {
+		if ((m = find_charmap(to)) < 0 || !get_revmap(m))
+			return -1;
+
+		t = TO_CHARMAP | m;
+	}
 
 	if ((f = find_charset(from)) < 255)
 		return 0 | (t<<1) | (f<<8);
@@ -125,19 +244,6 @@ int iconv_close(iconv_t cd)
 	return 0;
 }
 
-static inline wchar_t get_16(const unsigned char *s, int endian)
-{
-	endian &= 1;
-	return s[endian]<<8 | s[endian^1];
-}
-
-static inline void put_16(unsigned char *s, wchar_t c, int endian)
-{
-	endian &= 1;
-	s[endian] = c>>8;
-	s[endian^1] = c;
-}
-
 static inline int utf8enc_wchar(char *outb, wchar_t c)
 {
 	if (c <= 0x7F) {
@@ -425,7 +531,18 @@ charok:
 			*outb -= 4;
 			break;
 		default:
-			goto badf;
+			if (!(to & TO_CHARMAP)) goto badf;
+			if (c >= 0x80) {
+				/* wchar_t may be unsigned, keep the -1 in an int */
+				int b = revmap_lookup(revmaps[to & ~TO_CHARMAP], c);
+				if (b < 0) goto ilseq;
+				c = b;
+			}
+			if (!*outb) goto toobig;
+			**out = c;
+			++*out;
+			--*outb;
+			break;
 		}
 	}
 	return x;
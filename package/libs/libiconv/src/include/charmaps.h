@@ -31,10 +31,21 @@ struct charmap {
 	const unsigned char *map;
 };
 
+/* must be kept sorted case-insensitively, find_charmap() does a binary search */
 static struct charmap charmaps[] = {
-	{ "ISO-8859-2",   map_iso_8859_2   },
+#ifdef ALL_CHARSETS
+	{ "ARABIC",       map_iso_8859_6   },
+	{ "CYRILLIC",     map_iso_8859_5   },
+	{ "GREEK",        map_iso_8859_7   },
+	{ "HEBREW",       map_iso_8859_8   },
+#endif
 	{ "ISO-8859-10",  map_iso_8859_10  },
-
+#ifdef ALL_CHARSETS
+	{ "ISO-8859-13",  map_iso_8859_13  },
+	{ "ISO-8859-14",  map_iso_8859_14  },
+	{ "ISO-8859-16",  map_iso_8859_16  },
+#endif
+	{ "ISO-8859-2",   map_iso_8859_2   },
 #ifdef ALL_CHARSETS
 	{ "ISO-8859-3",   map_iso_8859_3   },
 	{ "ISO-8859-4",   map_iso_8859_4   },
@@ -43,14 +54,16 @@ static struct charmap charmaps[] = {
 	{ "ISO-8859-7",   map_iso_8859_7   },
 	{ "ISO-8859-8",   map_iso_8859_8   },
 	{ "ISO-8859-9",   map_iso_8859_9   },
-	{ "ISO-8859-13",  map_iso_8859_13  },
-	{ "ISO-8859-14",  map_iso_8859_14  },
-	{ "ISO-8859-16",  map_iso_8859_16  },
 #endif
-
-	{ "WINDOWS-874",  map_windows_874  },
+	{ "KOI8-R",       map_koi8_r       },
+	{ "LATIN2",       map_iso_8859_2   },
+#ifdef ALL_CHARSETS
+	{ "LATIN3",       map_iso_8859_3   },
+	{ "LATIN4",       map_iso_8859_4   },
+	{ "LATIN5",       map_iso_8859_9   },
+#endif
+	{ "LATIN6",       map_iso_8859_10  },
 	{ "WINDOWS-1250", map_windows_1250 },
-
 #ifdef ALL_CHARSETS
 	{ "WINDOWS-1251", map_windows_1251 },
 	{ "WINDOWS-1252", map_windows_1252 },
@@ -61,20 +74,5 @@ static struct charmap charmaps[] = {
 	{ "WINDOWS-1257", map_windows_1257 },
 	{ "WINDOWS-1258", map_windows_1258 },
 #endif
-
-	{ "KOI8-R",       map_koi8_r       },
-
-	/* Aliases */
-	{ "LATIN2",       map_iso_8859_2   },
-	{ "LATIN6",       map_iso_8859_10  },
-
-#ifdef ALL_CHARSETS
-	{ "ARABIC",       map_iso_8859_6   },
-	{ "CYRILLIC",     map_iso_8859_5   },
-	{ "GREEK",        map_iso_8859_7   },
-	{ "HEBREW",       map_iso_8859_8   },
-	{ "LATIN3",       map_iso_8859_3   },
-	{ "LATIN4",       map_iso_8859_4   },
-	{ "LATIN5",       map_iso_8859_9   },
-#endif
+	{ "WINDOWS-874",  map_windows_874  },
 };
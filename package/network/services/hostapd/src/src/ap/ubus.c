@@ -44,6 +44,62 @@ struct ubus_banned_client {
 	u8 addr[ETH_ALEN];
 };
 
+/* minimum interval between probe request notifications per station (ms) */
+#define UBUS_STA_PROBE_INTERVAL		100
+/* time to wait for a subscriber verdict before accepting a frame (ms) */
+#define UBUS_STA_VERDICT_DEADLINE	100
+/* lifetime of an unused verdict and of idle cache entries (s) */
+#define UBUS_STA_VERDICT_TTL		10
+#define UBUS_STA_CACHE_MAX		512
+
+struct ubus_sta_event {
+	struct ubus_notify_request nreq;
+	struct os_reltime time;
+	int resp;
+	bool pending;
+	/* verdict arrived, used for the next frame of this type only */
+	bool valid;
+	/* deadline hit, the next frame is accepted without waiting again */
+	bool expired;
+};
+
+struct ubus_sta_cache {
+	struct avl_node avl;
+	u8 addr[ETH_ALEN];
+	struct os_reltime last_seen;
+	struct os_reltime last_probe;
+	struct ubus_sta_event ev[HOSTAPD_UBUS_TYPE_MAX];
+};
+
+static void hostapd_ubus_sta_cache_drop(struct hostapd_data *hapd, const u8 *addr);
+
+/* number of removed clients remembered for incremental get_clients */
+#define UBUS_CLIENT_REMOVED_MAX		64
+
+struct ubus_client_cache {
+	struct avl_node avl;
+	u8 addr[ETH_ALEN];
+	u32 seq;
+	u32 gen;
+	bool removed;
+
+	/* station state the cached blob was built from */
+	u32 flags;
+	u16 aid;
+	u8 rrm_enabled_capa[5];
+	u8 *ext_capability;
+	bool vht;
+	struct ieee80211_vht_capabilities vht_capabilities;
+
+	struct blob_attr *data;
+};
+
+static int avl_compare_macaddr(const void *k1, const void *k2, void *ptr)
+{
+	return memcmp(k1, k2, ETH_ALEN);
+}
+
+
 static void ubus_receive(int sock, void *eloop_ctx, void *sock_ctx)
 {
 	struct ubus_context *ctx = eloop_ctx;
@@ -165,6 +221,7 @@ hostapd_bss_del_ban(void *eloop_data, void *user_ctx)
 	struct ubus_banned_client *ban = eloop_data;
 	struct hostapd_data *hapd = user_ctx;
 
+	hostapd_ubus_sta_cache_drop(hapd, ban->addr);
 	avl_delete(&hapd->ubus.banned, &ban->avl);
 	free(ban);
 }
@@ -177,6 +234,8 @@ hostapd_bss_ban_client(struct hostapd_data *hapd, u8 *addr, int time)
 	if (time < 0)
 		time = 0;
 
+	hostapd_ubus_sta_cache_drop(hapd, addr);
+
 	ban = avl_find_element(&hapd->ubus.banned, addr, ban, avl);
 	if (!ban) {
 		if (!time)
@@ -211,7 +270,7 @@ hostapd_bss_reload(struct ubus_context *ctx, struct ubus_object *obj,
 
 
 static void
-hostapd_parse_vht_map_blobmsg(uint16_t map)
+hostapd_parse_vht_map_blobmsg(struct blob_buf *buf, uint16_t map)
 {
 	char label[4];
 	int16_t val;
@@ -221,13 +280,14 @@ hostapd_parse_vht_map_blobmsg(uint16_t map)
 		snprintf(label, 4, "%dss", i + 1);
 
 		val = (map & (BIT(1) | BIT(0))) + 7;
-		blobmsg_add_u16(&b, label, val == 10 ? -1 : val);
+		blobmsg_add_u16(buf, label, val == 10 ? -1 : val);
 		map = map >> 2;
 	}
 }
 
 static void
-hostapd_parse_vht_capab_blobmsg(struct ieee80211_vht_capabilities *vhtc)
+hostapd_parse_vht_capab_blobmsg(struct blob_buf *buf,
+				struct ieee80211_vht_capabilities *vhtc)
 {
 	void *supported_mcs;
 	void *map;
@@ -242,52 +302,91 @@ hostapd_parse_vht_capab_blobmsg(struct ieee80211_vht_capabilities *vhtc)
 	};
 
 	for (i = 0; i < ARRAY_SIZE(vht_capas); i++)
-		blobmsg_add_u8(&b, vht_capas[i].name,
+		blobmsg_add_u8(buf, vht_capas[i].name,
 				!!(vhtc->vht_capabilities_info & vht_capas[i].flag));
 
-	supported_mcs = blobmsg_open_table(&b, "mcs_map");
+	supported_mcs = blobmsg_open_table(buf, "mcs_map");
 
 	/* RX map */
-	map = blobmsg_open_table(&b, "rx");
-	hostapd_parse_vht_map_blobmsg(le_to_host16(vhtc->vht_supported_mcs_set.rx_map));
-	blobmsg_close_table(&b, map);
+	map = blobmsg_open_table(buf, "rx");
+	hostapd_parse_vht_map_blobmsg(buf, le_to_host16(vhtc->vht_supported_mcs_set.rx_map));
+	blobmsg_close_table(buf, map);
 
 	/* TX map */
-	map = blobmsg_open_table(&b, "tx");
-	hostapd_parse_vht_map_blobmsg(le_to_host16(vhtc->vht_supported_mcs_set.tx_map));
-	blobmsg_close_table(&b, map);
+	map = blobmsg_open_table(buf, "tx");
+	hostapd_parse_vht_map_blobmsg(buf, le_to_host16(vhtc->vht_supported_mcs_set.tx_map));
+	blobmsg_close_table(buf, map);
 
-	blobmsg_close_table(&b, supported_mcs);
+	blobmsg_close_table(buf, supported_mcs);
 }
 
 static void
-hostapd_parse_capab_blobmsg(struct sta_info *sta)
+hostapd_parse_capab_blobmsg(struct blob_buf *buf, struct sta_info *sta)
 {
 	void *r, *v;
 
-	v = blobmsg_open_table(&b, "capabilities");
+	v = blobmsg_open_table(buf, "capabilities");
 
 	if (sta->vht_capabilities) {
-		r = blobmsg_open_table(&b, "vht");
-		hostapd_parse_vht_capab_blobmsg(sta->vht_capabilities);
-		blobmsg_close_table(&b, r);
+		r = blobmsg_open_table(buf, "vht");
+		hostapd_parse_vht_capab_blobmsg(buf, sta->vht_capabilities);
+		blobmsg_close_table(buf, r);
 	}
 
 	/* ToDo: Add HT / HE capability parsing */
 
-	blobmsg_close_table(&b, v);
+	blobmsg_close_table(buf, v);
 }
 
-static int
-hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
-			struct ubus_request_data *req, const char *method,
-			struct blob_attr *msg)
+static void
+blobmsg_add_macaddr(struct blob_buf *buf, const char *name, const u8 *addr)
 {
-	struct hostapd_data *hapd = container_of(obj, struct hostapd_data, ubus.obj);
-	struct hostap_sta_driver_data sta_driver_data;
-	struct sta_info *sta;
-	void *list, *c;
-	char mac_buf[20];
+	char *s;
+
+	s = blobmsg_alloc_string_buffer(buf, name, 20);
+	sprintf(s, MACSTR, MAC2STR(addr));
+	blobmsg_add_string_buffer(buf);
+}
+
+static bool
+hostapd_client_cache_valid(struct ubus_client_cache *cl, struct sta_info *sta)
+{
+	if (cl->removed || !cl->data)
+		return false;
+
+	if (cl->flags != sta->flags || cl->aid != sta->aid)
+		return false;
+
+	if (memcmp(cl->rrm_enabled_capa, sta->rrm_enabled_capa,
+		   sizeof(cl->rrm_enabled_capa)))
+		return false;
+
+	if (!cl->ext_capability != !sta->ext_capability)
+		return false;
+
+	/* the cached copy is only as long as its own length byte says */
+	if (sta->ext_capability &&
+	    (cl->ext_capability[0] != sta->ext_capability[0] ||
+	     memcmp(cl->ext_capability + 1, sta->ext_capability + 1,
+		    sta->ext_capability[0])))
+		return false;
+
+	if (cl->vht != !!sta->vht_capabilities)
+		return false;
+
+	if (sta->vht_capabilities &&
+	    memcmp(&cl->vht_capabilities, sta->vht_capabilities,
+		   sizeof(cl->vht_capabilities)))
+		return false;
+
+	return true;
+}
+
+static void
+hostapd_client_cache_update(struct hostapd_data *hapd,
+			    struct ubus_client_cache *cl, struct sta_info *sta)
+{
+	static struct blob_buf sb;
 	static const struct {
 		const char *name;
 		uint32_t flag;
@@ -304,40 +403,183 @@ hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
 		{ "wps", WLAN_STA_WPS },
 		{ "mfp", WLAN_STA_MFP },
 	};
+	void *r;
+	int i;
+
+	cl->flags = sta->flags;
+	cl->aid = sta->aid;
+	memcpy(cl->rrm_enabled_capa, sta->rrm_enabled_capa,
+	       sizeof(cl->rrm_enabled_capa));
+
+	os_free(cl->ext_capability);
+	cl->ext_capability = NULL;
+	if (sta->ext_capability)
+		cl->ext_capability = os_memdup(sta->ext_capability,
+					       1 + sta->ext_capability[0]);
+
+	cl->vht = !!sta->vht_capabilities;
+	if (sta->vht_capabilities)
+		memcpy(&cl->vht_capabilities, sta->vht_capabilities,
+		       sizeof(cl->vht_capabilities));
+
+	blob_buf_init(&sb, 0);
+	for (i = 0; i < ARRAY_SIZE(sta_flags); i++)
+		blobmsg_add_u8(&sb, sta_flags[i].name,
+			       !!(sta->flags & sta_flags[i].flag));
+
+	r = blobmsg_open_array(&sb, "rrm");
+	for (i = 0; i < ARRAY_SIZE(sta->rrm_enabled_capa); i++)
+		blobmsg_add_u32(&sb, "", sta->rrm_enabled_capa[i]);
+	blobmsg_close_array(&sb, r);
+
+	r = blobmsg_open_array(&sb, "extended_capabilities");
+	/* Check if client advertises extended capabilities */
+	if (sta->ext_capability && sta->ext_capability[0] > 0) {
+		for (i = 0; i < sta->ext_capability[0]; i++) {
+			blobmsg_add_u32(&sb, "", sta->ext_capability[1 + i]);
+		}
+	}
+	blobmsg_close_array(&sb, r);
+
+	blobmsg_add_u32(&sb, "aid", sta->aid);
+#ifdef CONFIG_TAXONOMY
+	r = blobmsg_alloc_string_buffer(&sb, "signature", 1024);
+	if (retrieve_sta_taxonomy(hapd, sta, r, 1024) > 0)
+		blobmsg_add_string_buffer(&sb);
+#endif
+
+	hostapd_parse_capab_blobmsg(&sb, sta);
+
+	free(cl->data);
+	cl->data = blob_memdup(sb.head);
+	cl->removed = false;
+	cl->seq = ++hapd->ubus.clients_seq;
+}
+
+static void
+hostapd_client_cache_free(struct hostapd_data *hapd, struct ubus_client_cache *cl)
+{
+	if (cl->removed)
+		hapd->ubus.n_clients_removed--;
+
+	avl_delete(&hapd->ubus.clients, &cl->avl);
+	os_free(cl->ext_capability);
+	free(cl->data);
+	os_free(cl);
+}
+
+static void
+hostapd_client_cache_expire(struct hostapd_data *hapd)
+{
+	struct ubus_client_cache *cl, *tmp, *oldest;
+
+	avl_for_each_element_safe(&hapd->ubus.clients, cl, avl, tmp) {
+		if (cl->removed || cl->gen == hapd->ubus.clients_gen)
+			continue;
+
+		/* keep a tombstone so incremental callers learn about it */
+		os_free(cl->ext_capability);
+		cl->ext_capability = NULL;
+		free(cl->data);
+		cl->data = NULL;
+		cl->removed = true;
+		cl->seq = ++hapd->ubus.clients_seq;
+		hapd->ubus.n_clients_removed++;
+	}
+
+	while (hapd->ubus.n_clients_removed > UBUS_CLIENT_REMOVED_MAX) {
+		oldest = NULL;
+		avl_for_each_element(&hapd->ubus.clients, cl, avl)
+			if (cl->removed && (!oldest || cl->seq < oldest->seq))
+				oldest = cl;
+
+		/* callers asking for changes before this need a full list */
+		hapd->ubus.clients_purged_seq = oldest->seq;
+		hostapd_client_cache_free(hapd, oldest);
+	}
+}
+
+static void
+hostapd_client_cache_flush(struct hostapd_data *hapd)
+{
+	struct ubus_client_cache *cl, *tmp;
+
+	avl_for_each_element_safe(&hapd->ubus.clients, cl, avl, tmp)
+		hostapd_client_cache_free(hapd, cl);
+}
+
+enum {
+	GET_CLIENTS_SINCE,
+	__GET_CLIENTS_MAX
+};
+
+static const struct blobmsg_policy get_clients_policy[__GET_CLIENTS_MAX] = {
+	[GET_CLIENTS_SINCE] = { "since", BLOBMSG_TYPE_INT32 },
+};
+
+static int
+hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
+			struct ubus_request_data *req, const char *method,
+			struct blob_attr *msg)
+{
+	struct hostapd_data *hapd = container_of(obj, struct hostapd_data, ubus.obj);
+	struct blob_attr *tb[__GET_CLIENTS_MAX];
+	struct hostap_sta_driver_data sta_driver_data;
+	struct ubus_client_cache *cl;
+	struct blob_attr *cur;
+	struct sta_info *sta;
+	bool incremental = false;
+	u32 since = 0;
+	void *list, *c;
+	char mac_buf[20];
+	int rem;
+
+	blobmsg_parse(get_clients_policy, __GET_CLIENTS_MAX, tb,
+		      blob_data(msg), blob_len(msg));
+
+	if (tb[GET_CLIENTS_SINCE]) {
+		since = blobmsg_get_u32(tb[GET_CLIENTS_SINCE]);
+		incremental = since >= hapd->ubus.clients_purged_seq &&
+			      since <= hapd->ubus.clients_seq;
+	}
+
+	hapd->ubus.clients_gen++;
 
 	blob_buf_init(&b, 0);
 	blobmsg_add_u32(&b, "freq", hapd->iface->freq);
 	list = blobmsg_open_table(&b, "clients");
 	for (sta = hapd->sta_list; sta; sta = sta->next) {
 		void *r;
-		int i;
+
+		cl = avl_find_element(&hapd->ubus.clients, sta->addr, cl, avl);
+		if (!cl) {
+			cl = os_zalloc(sizeof(*cl));
+			if (!cl)
+				continue;
+
+			memcpy(cl->addr, sta->addr, sizeof(cl->addr));
+			cl->avl.key = cl->addr;
+			avl_insert(&hapd->ubus.clients, &cl->avl);
+		}
+
+		if (cl->removed) {
+			cl->removed = false;
+			hapd->ubus.n_clients_removed--;
+		}
+
+		cl->gen = hapd->ubus.clients_gen;
+
+		if (!hostapd_client_cache_valid(cl, sta))
+			hostapd_client_cache_update(hapd, cl, sta);
+
+		if (!cl->data || (incremental && cl->seq <= since))
+			continue;
 
 		sprintf(mac_buf, MACSTR, MAC2STR(sta->addr));
 		c = blobmsg_open_table(&b, mac_buf);
-		for (i = 0; i < ARRAY_SIZE(sta_flags); i++)
-			blobmsg_add_u8(&b, sta_flags[i].name,
-				       !!(sta->flags & sta_flags[i].flag));
-
-		r = blobmsg_open_array(&b, "rrm");
-		for (i = 0; i < ARRAY_SIZE(sta->rrm_enabled_capa); i++)
-			blobmsg_add_u32(&b, "", sta->rrm_enabled_capa[i]);
-		blobmsg_close_array(&b, r);
-
-		r = blobmsg_open_array(&b, "extended_capabilities");
-		/* Check if client advertises extended capabilities */
-		if (sta->ext_capability && sta->ext_capability[0] > 0) {
-			for (i = 0; i < sta->ext_capability[0]; i++) {
-				blobmsg_add_u32(&b, "", sta->ext_capability[1 + i]);
-			}
-		}
-		blobmsg_close_array(&b, r);
 
-		blobmsg_add_u32(&b, "aid", sta->aid);
-#ifdef CONFIG_TAXONOMY
-		r = blobmsg_alloc_string_buffer(&b, "signature", 1024);
-		if (retrieve_sta_taxonomy(hapd, sta, r, 1024) > 0)
-			blobmsg_add_string_buffer(&b);
-#endif
+		blob_for_each_attr(cur, cl->data, rem)
+			blobmsg_add_blob(&b, cur);
 
 		/* Driver information */
 		if (hostapd_drv_read_sta_data(hapd, &sta_driver_data, sta->addr) >= 0) {
@@ -361,11 +603,24 @@ hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
 			blobmsg_add_u32(&b, "signal", sta_driver_data.signal);
 		}
 
-		hostapd_parse_capab_blobmsg(sta);
-
 		blobmsg_close_table(&b, c);
 	}
 	blobmsg_close_array(&b, list);
+
+	hostapd_client_cache_expire(hapd);
+
+	if (incremental) {
+		list = blobmsg_open_array(&b, "removed");
+		avl_for_each_element(&hapd->ubus.clients, cl, avl) {
+			if (!cl->removed || cl->seq <= since)
+				continue;
+
+			blobmsg_add_macaddr(&b, NULL, cl->addr);
+		}
+		blobmsg_close_array(&b, list);
+	}
+
+	blobmsg_add_u32(&b, "seq", hapd->ubus.clients_seq);
 	ubus_send_reply(ctx, req, b.head);
 
 	return 0;
@@ -554,6 +809,9 @@ hostapd_bss_del_client(struct ubus_context *ctx, struct ubus_object *obj,
 	if (tb[DEL_CLIENT_DEAUTH])
 		deauth = blobmsg_get_bool(tb[DEL_CLIENT_DEAUTH]);
 
+	/* verdicts given so far no longer apply to this station */
+	hostapd_ubus_sta_cache_drop(hapd, addr);
+
 	sta = ap_get_sta(hapd, addr);
 	if (sta) {
 		if (deauth) {
@@ -571,16 +829,6 @@ hostapd_bss_del_client(struct ubus_context *ctx, struct ubus_object *obj,
 	return 0;
 }
 
-static void
-blobmsg_add_macaddr(struct blob_buf *buf, const char *name, const u8 *addr)
-{
-	char *s;
-
-	s = blobmsg_alloc_string_buffer(buf, name, 20);
-	sprintf(s, MACSTR, MAC2STR(addr));
-	blobmsg_add_string_buffer(buf);
-}
-
 static int
 hostapd_bss_list_bans(struct ubus_context *ctx, struct ubus_object *obj,
 		      struct ubus_request_data *req, const char *method,
@@ -1674,7 +1922,7 @@ hostapd_bss_update_airtime(struct ubus_context *ctx, struct ubus_object *obj,
 
 static const struct ubus_method bss_methods[] = {
 	UBUS_METHOD_NOARG("reload", hostapd_bss_reload),
-	UBUS_METHOD_NOARG("get_clients", hostapd_bss_get_clients),
+	UBUS_METHOD("get_clients", hostapd_bss_get_clients, get_clients_policy),
 	UBUS_METHOD_NOARG("get_status", hostapd_bss_get_status),
 	UBUS_METHOD("del_client", hostapd_bss_del_client, del_policy),
 #ifdef CONFIG_AIRTIME_POLICY
@@ -1708,9 +1956,192 @@ static const struct ubus_method bss_methods[] = {
 static struct ubus_object_type bss_object_type =
 	UBUS_OBJECT_TYPE("hostapd_bss", bss_methods);
 
-static int avl_compare_macaddr(const void *k1, const void *k2, void *ptr)
+static int reltime_ms_since(struct os_reltime *now, struct os_reltime *ts)
 {
-	return memcmp(k1, k2, ETH_ALEN);
+	struct os_reltime age;
+
+	os_reltime_sub(now, ts, &age);
+
+	return age.sec * 1000 + age.usec / 1000;
+}
+
+static void
+hostapd_ubus_sta_event_deadline(void *eloop_data, void *user_ctx)
+{
+	struct ubus_sta_event *ev = eloop_data;
+
+	/* subscriber too slow, accept the retransmission as a timed out
+	 * synchronous notify would have; this is not a verdict */
+	ubus_abort_request(ctx, &ev->nreq.req);
+	ev->pending = false;
+	ev->valid = false;
+	ev->expired = true;
+	os_get_reltime(&ev->time);
+}
+
+static void
+hostapd_ubus_sta_event_status_cb(struct ubus_notify_request *req, int idx, int ret)
+{
+	struct ubus_sta_event *ev = container_of(req, struct ubus_sta_event, nreq);
+
+	if (ret && !ev->resp)
+		ev->resp = ret;
+}
+
+static void
+hostapd_ubus_sta_event_complete_cb(struct ubus_notify_request *req, int idx, int ret)
+{
+	struct ubus_sta_event *ev = container_of(req, struct ubus_sta_event, nreq);
+
+	eloop_cancel_timeout(hostapd_ubus_sta_event_deadline, ev, NULL);
+	ev->pending = false;
+	ev->valid = true;
+	ev->expired = false;
+	os_get_reltime(&ev->time);
+}
+
+static void
+hostapd_ubus_sta_cache_del(struct hostapd_data *hapd, struct ubus_sta_cache *sta)
+{
+	int i;
+
+	for (i = 0; i < HOSTAPD_UBUS_TYPE_MAX; i++) {
+		if (!sta->ev[i].pending)
+			continue;
+
+		eloop_cancel_timeout(hostapd_ubus_sta_event_deadline, &sta->ev[i], NULL);
+		ubus_abort_request(ctx, &sta->ev[i].nreq.req);
+	}
+
+	avl_delete(&hapd->ubus.sta_cache, &sta->avl);
+	hapd->ubus.n_sta_cache--;
+	os_free(sta);
+}
+
+static void
+hostapd_ubus_sta_cache_gc(void *eloop_data, void *user_ctx)
+{
+	struct hostapd_data *hapd = eloop_data;
+	struct ubus_sta_cache *sta, *tmp;
+	struct os_reltime now;
+	int i;
+
+	os_get_reltime(&now);
+
+	avl_for_each_element_safe(&hapd->ubus.sta_cache, sta, avl, tmp) {
+		if (!os_reltime_expired(&now, &sta->last_seen, UBUS_STA_VERDICT_TTL))
+			continue;
+
+		for (i = 0; i < HOSTAPD_UBUS_TYPE_MAX; i++)
+			if (sta->ev[i].pending)
+				break;
+
+		if (i == HOSTAPD_UBUS_TYPE_MAX)
+			hostapd_ubus_sta_cache_del(hapd, sta);
+	}
+
+	if (hapd->ubus.n_sta_cache)
+		eloop_register_timeout(UBUS_STA_VERDICT_TTL, 0,
+				       hostapd_ubus_sta_cache_gc, hapd, NULL);
+}
+
+static bool
+hostapd_ubus_sta_cache_idle(struct ubus_sta_cache *sta, bool *probe_only)
+{
+	int i;
+
+	*probe_only = true;
+	for (i = 0; i < HOSTAPD_UBUS_TYPE_MAX; i++) {
+		if (sta->ev[i].pending)
+			return false;
+		if (i != HOSTAPD_UBUS_PROBE_REQ &&
+		    (sta->ev[i].valid || sta->ev[i].expired))
+			*probe_only = false;
+	}
+
+	return true;
+}
+
+/* Make room by dropping the least recently seen entry without an
+ * outstanding request, stations that only probed go first */
+static bool
+hostapd_ubus_sta_cache_evict(struct hostapd_data *hapd)
+{
+	struct ubus_sta_cache *sta, *victim = NULL;
+	bool probe_only, victim_probe_only = false;
+
+	avl_for_each_element(&hapd->ubus.sta_cache, sta, avl) {
+		if (!hostapd_ubus_sta_cache_idle(sta, &probe_only))
+			continue;
+
+		if (victim) {
+			if (victim_probe_only && !probe_only)
+				continue;
+			if (victim_probe_only == probe_only &&
+			    !os_reltime_before(&sta->last_seen, &victim->last_seen))
+				continue;
+		}
+
+		victim = sta;
+		victim_probe_only = probe_only;
+	}
+
+	if (!victim)
+		return false;
+
+	hostapd_ubus_sta_cache_del(hapd, victim);
+
+	return true;
+}
+
+static struct ubus_sta_cache *
+hostapd_ubus_sta_cache_get(struct hostapd_data *hapd, const u8 *addr)
+{
+	struct ubus_sta_cache *sta;
+
+	sta = avl_find_element(&hapd->ubus.sta_cache, addr, sta, avl);
+	if (sta)
+		return sta;
+
+	if (hapd->ubus.n_sta_cache >= UBUS_STA_CACHE_MAX &&
+	    !hostapd_ubus_sta_cache_evict(hapd))
+		return NULL;
+
+	sta = os_zalloc(sizeof(*sta));
+	if (!sta)
+		return NULL;
+
+	memcpy(sta->addr, addr, sizeof(sta->addr));
+
+	sta->avl.key = sta->addr;
+	avl_insert(&hapd->ubus.sta_cache, &sta->avl);
+
+	if (!hapd->ubus.n_sta_cache++)
+		eloop_register_timeout(UBUS_STA_VERDICT_TTL, 0,
+				       hostapd_ubus_sta_cache_gc, hapd, NULL);
+
+	return sta;
+}
+
+static void
+hostapd_ubus_sta_cache_drop(struct hostapd_data *hapd, const u8 *addr)
+{
+	struct ubus_sta_cache *sta;
+
+	sta = avl_find_element(&hapd->ubus.sta_cache, addr, sta, avl);
+	if (sta)
+		hostapd_ubus_sta_cache_del(hapd, sta);
+}
+
+static void
+hostapd_ubus_sta_cache_flush(struct hostapd_data *hapd)
+{
+	struct ubus_sta_cache *sta, *tmp;
+
+	eloop_cancel_timeout(hostapd_ubus_sta_cache_gc, hapd, NULL);
+
+	avl_for_each_element_safe(&hapd->ubus.sta_cache, sta, avl, tmp)
+		hostapd_ubus_sta_cache_del(hapd, sta);
 }
 
 void hostapd_ubus_add_bss(struct hostapd_data *hapd)
@@ -1731,6 +2162,8 @@ void hostapd_ubus_add_bss(struct hostapd_data *hapd)
 		return;
 
 	avl_init(&hapd->ubus.banned, avl_compare_macaddr, false, NULL);
+	avl_init(&hapd->ubus.sta_cache, avl_compare_macaddr, false, NULL);
+	avl_init(&hapd->ubus.clients, avl_compare_macaddr, false, NULL);
 	obj->name = name;
 	obj->type = &bss_object_type;
 	obj->methods = bss_object_type.methods;
@@ -1756,6 +2189,9 @@ void hostapd_ubus_free_bss(struct hostapd_data *hapd)
 
 	hostapd_send_shared_event(&hapd->iface->interfaces->ubus, hapd->conf->iface, "remove");
 
+	hostapd_ubus_sta_cache_flush(hapd);
+	hostapd_client_cache_flush(hapd);
+
 	if (obj->id) {
 		ubus_remove_object(ctx, obj);
 		hostapd_ubus_ref_dec();
@@ -1864,7 +2300,11 @@ int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_req
 		[HOSTAPD_UBUS_ASSOC_REQ] = "assoc",
 	};
 	const char *type = "mgmt";
-	struct ubus_event_req ureq = {};
+	struct ubus_sta_cache *sta = NULL;
+	struct ubus_sta_event *ev = NULL;
+	struct os_reltime now;
+	int verdict = WLAN_STATUS_SUCCESS;
+	bool defer;
 	const u8 *addr;
 
 	if (req->mgmt_frame)
@@ -1882,6 +2322,52 @@ int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_req
 	if (req->type < ARRAY_SIZE(types))
 		type = types[req->type];
 
+	/* Only frames received by hostapd itself can be deferred, the station
+	 * retransmits them while the subscriber verdict is outstanding */
+	defer = req->mgmt_frame && req->type != HOSTAPD_UBUS_PROBE_REQ;
+
+	if (req->type < HOSTAPD_UBUS_TYPE_MAX)
+		sta = hostapd_ubus_sta_cache_get(hapd, addr);
+
+	if (sta) {
+		os_get_reltime(&now);
+		sta->last_seen = now;
+		ev = &sta->ev[req->type];
+
+		if ((ev->valid || ev->expired) &&
+		    os_reltime_expired(&now, &ev->time, UBUS_STA_VERDICT_TTL)) {
+			ev->valid = false;
+			ev->expired = false;
+		}
+
+		/* coalesce retransmissions only while the subscriber decides */
+		if (ev->pending)
+			return defer ? HOSTAPD_UBUS_DEFERRED : WLAN_STATUS_SUCCESS;
+
+		if (ev->valid) {
+			ev->valid = false;
+			/* the retransmission of a deferred frame takes its verdict */
+			if (defer)
+				return ev->resp;
+			/* frames that cannot wait get the verdict on the previous
+			 * one and are still passed on to the subscriber */
+			verdict = ev->resp;
+		}
+
+		if (ev->expired) {
+			ev->expired = false;
+			defer = false;
+		}
+
+		if (req->type == HOSTAPD_UBUS_PROBE_REQ) {
+			if (os_reltime_initialized(&sta->last_probe) &&
+			    reltime_ms_since(&now, &sta->last_probe) < UBUS_STA_PROBE_INTERVAL)
+				return verdict;
+
+			sta->last_probe = now;
+		}
+	}
+
 	blob_buf_init(&b, 0);
 	blobmsg_add_macaddr(&b, "address", addr);
 	if (req->mgmt_frame)
@@ -1936,16 +2422,35 @@ int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_req
 		return WLAN_STATUS_SUCCESS;
 	}
 
-	if (ubus_notify_async(ctx, &hapd->ubus.obj, type, b.head, &ureq.nreq))
+	/* no cache entry to track the request, wait for the verdict */
+	if (!ev) {
+		struct ubus_event_req ureq = {};
+
+		if (ubus_notify_async(ctx, &hapd->ubus.obj, type, b.head, &ureq.nreq))
+			return WLAN_STATUS_SUCCESS;
+
+		ureq.nreq.status_cb = ubus_event_cb;
+		ubus_complete_request(ctx, &ureq.nreq.req, 100);
+
+		if (ureq.resp)
+			return ureq.resp;
+
 		return WLAN_STATUS_SUCCESS;
+	}
 
-	ureq.nreq.status_cb = ubus_event_cb;
-	ubus_complete_request(ctx, &ureq.nreq.req, 100);
+	memset(&ev->nreq, 0, sizeof(ev->nreq));
+	if (ubus_notify_async(ctx, &hapd->ubus.obj, type, b.head, &ev->nreq))
+		return verdict;
 
-	if (ureq.resp)
-		return ureq.resp;
+	ev->nreq.status_cb = hostapd_ubus_sta_event_status_cb;
+	ev->nreq.complete_cb = hostapd_ubus_sta_event_complete_cb;
+	ev->resp = 0;
+	ev->pending = true;
+	ubus_complete_request_async(ctx, &ev->nreq.req);
+	eloop_register_timeout(0, UBUS_STA_VERDICT_DEADLINE * 1000,
+			       hostapd_ubus_sta_event_deadline, ev, NULL);
 
-	return WLAN_STATUS_SUCCESS;
+	return defer ? HOSTAPD_UBUS_DEFERRED : verdict;
 }
 
 void hostapd_ubus_notify(struct hostapd_data *hapd, const char *type, const u8 *addr)
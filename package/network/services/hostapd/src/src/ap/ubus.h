@@ -15,6 +15,11 @@ enum hostapd_ubus_event_type {
 	HOSTAPD_UBUS_TYPE_MAX
 };
 
+/* returned by hostapd_ubus_handle_event() while a subscriber verdict for
+ * an auth/assoc frame is outstanding; the frame is dropped without reply
+ * and the retransmission is answered from the cached verdict */
+#define HOSTAPD_UBUS_DEFERRED	-2
+
 struct hostapd_ubus_request {
 	enum hostapd_ubus_event_type type;
 	const struct ieee80211_mgmt *mgmt_frame;
@@ -36,6 +41,13 @@ struct rrm_measurement_beacon_report;
 struct hostapd_ubus_bss {
 	struct ubus_object obj;
 	struct avl_tree banned;
+	struct avl_tree sta_cache;
+	int n_sta_cache;
+	struct avl_tree clients;
+	u32 clients_seq;
+	u32 clients_gen;
+	u32 clients_purged_seq;
+	int n_clients_removed;
 	int notify_response;
 };
 
@@ -26,15 +26,21 @@
 #include <signal.h>
 #include <syslog.h>
 #include <errno.h>
+#include <poll.h>
+#include <limits.h>
 #include <byteswap.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
 #include <sys/socket.h>
 #include <net/ethernet.h>
 #include <net/if.h>
 #include <netinet/in.h>
 #include <linux/if_packet.h>
+#include <linux/filter.h>
 
 #define ARPHRD_IEEE80211_RADIOTAP	803
 
@@ -45,6 +51,17 @@
 #define FRAMETYPE_BEACON			0x80
 #define FRAMETYPE_DATA				0x08
 
+#define RING_BLOCK_SIZE				(1 << 17)	/* fits a full 64KB frame */
+#define RING_BLOCK_NR				8
+#define RING_FRAME_SIZE				2048
+#define RING_BLOCK_TIMEOUT			50			/* ms until a partial block is retired */
+
+#define STREAM_BATCH				256			/* frames per writev() */
+
+#ifndef IOV_MAX
+#define IOV_MAX						1024
+#endif
+
 #if __BYTE_ORDER == __BIG_ENDIAN
 #define le16(x) __bswap_16(x)
 #else
@@ -52,11 +69,13 @@
 #endif
 
 uint8_t run_dump   = 0;
+uint8_t run_reap   = 0;
 uint8_t run_stop   = 0;
 uint8_t run_daemon = 0;
 
 uint32_t frames_captured = 0;
 uint32_t frames_filtered = 0;
+uint32_t frames_dropped  = 0;
 
 int capture_sock = -1;
 const char *ifname = NULL;
@@ -69,6 +88,12 @@ struct ringbuf {
 	void *buf;               /* ring memory */
 };
 
+struct capture_ring {
+	uint8_t *map;            /* mmap()ed PACKET_RX_RING */
+	uint32_t block;          /* next block to process */
+	struct tpacket_req3 req;
+};
+
 struct ringbuf_entry {
 	uint32_t len;            /* used slot memory */
 	uint32_t olen;           /* original data size */
@@ -145,11 +170,168 @@ int set_promisc(int on)
 }
 
 
+int attach_filter(uint8_t filter_data, uint8_t filter_beacon, uint32_t snaplen)
+{
+	/* Comparing a masked frame type byte against 0x100 never matches,
+	 * this disables the respective jump without changing the program
+	 * layout. Frames too short to hold the radiotap length or the frame
+	 * control field fail the loads and are dropped by the kernel. */
+	struct sock_filter code[] = {
+		/* X = le16(it_len) */
+		BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 3),
+		BPF_STMT(BPF_ALU | BPF_LSH | BPF_K,   8),
+		BPF_STMT(BPF_MISC | BPF_TAX,          0),
+		BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 2),
+		BPF_STMT(BPF_ALU | BPF_OR  | BPF_X,   0),
+		BPF_STMT(BPF_MISC | BPF_TAX,          0),
+
+		/* A = frame control & FRAMETYPE_MASK */
+		BPF_STMT(BPF_LD  | BPF_B   | BPF_IND, 0),
+		BPF_STMT(BPF_ALU | BPF_AND | BPF_K,   FRAMETYPE_MASK),
+
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+		         filter_data ? FRAMETYPE_DATA : 0x100, 2, 0),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+		         filter_beacon ? FRAMETYPE_BEACON : 0x100, 1, 0),
+
+		/* accept, truncated to snaplen */
+		BPF_STMT(BPF_RET | BPF_K, snaplen),
+
+		/* drop */
+		BPF_STMT(BPF_RET | BPF_K, 0),
+	};
+
+	struct sock_fprog prog = {
+		.len    = sizeof(code) / sizeof(code[0]),
+		.filter = code
+	};
+
+	return setsockopt(capture_sock, SOL_SOCKET, SO_ATTACH_FILTER,
+	                  &prog, sizeof(prog));
+}
+
+int setup_capture_ring(struct capture_ring *cr)
+{
+	int ver = TPACKET_V3;
+
+	memset(cr, 0, sizeof(*cr));
+
+	cr->req.tp_block_size       = RING_BLOCK_SIZE;
+	cr->req.tp_block_nr         = RING_BLOCK_NR;
+	cr->req.tp_frame_size       = RING_FRAME_SIZE;
+	cr->req.tp_frame_nr         = (RING_BLOCK_SIZE * RING_BLOCK_NR) / RING_FRAME_SIZE;
+	cr->req.tp_retire_blk_tov   = RING_BLOCK_TIMEOUT;
+	cr->req.tp_feature_req_word = 0;
+
+	if (setsockopt(capture_sock, SOL_PACKET, PACKET_VERSION,
+	               &ver, sizeof(ver)))
+		return -1;
+
+	if (setsockopt(capture_sock, SOL_PACKET, PACKET_RX_RING,
+	               &cr->req, sizeof(cr->req)))
+		return -1;
+
+	cr->map = mmap(NULL, cr->req.tp_block_size * cr->req.tp_block_nr,
+	               PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED,
+	               capture_sock, 0);
+
+	if (cr->map == MAP_FAILED)
+		cr->map = mmap(NULL, cr->req.tp_block_size * cr->req.tp_block_nr,
+		               PROT_READ | PROT_WRITE, MAP_SHARED,
+		               capture_sock, 0);
+
+	if (cr->map == MAP_FAILED)
+	{
+		cr->map = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+struct tpacket_block_desc * capture_ring_next(struct capture_ring *cr)
+{
+	struct tpacket_block_desc *bd = (struct tpacket_block_desc *)
+		(cr->map + cr->block * cr->req.tp_block_size);
+
+	if (!(__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) &
+	      TP_STATUS_USER))
+		return NULL;
+
+	return bd;
+}
+
+void capture_ring_release(struct capture_ring *cr,
+                          struct tpacket_block_desc *bd)
+{
+	__atomic_store_n(&bd->hdr.bh1.block_status, TP_STATUS_KERNEL,
+	                 __ATOMIC_RELEASE);
+
+	cr->block = (cr->block + 1) % cr->req.tp_block_nr;
+}
+
+void capture_ring_free(struct capture_ring *cr)
+{
+	if (cr->map)
+		munmap(cr->map, cr->req.tp_block_size * cr->req.tp_block_nr);
+
+	memset(cr, 0, sizeof(*cr));
+}
+
+void update_stats(void)
+{
+	struct tpacket_stats_v3 st;
+	socklen_t len = sizeof(st);
+
+	/* the kernel resets its counters on every read */
+	if (!getsockopt(capture_sock, SOL_PACKET, PACKET_STATISTICS, &st, &len))
+		frames_dropped += st.tp_drops;
+}
+
+int writev_all(int fd, struct iovec *iov, int cnt)
+{
+	ssize_t len;
+
+	while (cnt > 0)
+	{
+		len = writev(fd, iov, (cnt > IOV_MAX) ? IOV_MAX : cnt);
+
+		if (len < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			return -1;
+		}
+
+		while (cnt > 0 && len >= iov->iov_len)
+		{
+			len -= iov->iov_len;
+			iov++;
+			cnt--;
+		}
+
+		if (cnt > 0)
+		{
+			iov->iov_base = (uint8_t *)iov->iov_base + len;
+			iov->iov_len -= len;
+		}
+	}
+
+	return 0;
+}
+
+
 void sig_dump(int sig)
 {
 	run_dump = 1;
 }
 
+void sig_child(int sig)
+{
+	run_reap = 1;
+}
+
 void sig_teardown(int sig)
 {
 	run_stop = 1;
@@ -203,7 +385,8 @@ struct ringbuf * ringbuf_init(uint32_t num_item, uint16_t len_item)
 	if (len_item <= 0)
 		return NULL;
 
-	r.buf = malloc(num_item * (len_item + sizeof(struct ringbuf_entry)));
+	/* zeroed once here, a slot with len 0 is unused */
+	r.buf = calloc(num_item, len_item + sizeof(struct ringbuf_entry));
 
 	if (r.buf)
 	{
@@ -211,28 +394,23 @@ struct ringbuf * ringbuf_init(uint32_t num_item, uint16_t len_item)
 		r.fill = 0;
 		r.slen = (len_item + sizeof(struct ringbuf_entry));
 
-		memset(r.buf, 0, num_item * len_item);
-
 		return &r;
 	}
 
 	return NULL;
 }
 
-struct ringbuf_entry * ringbuf_add(struct ringbuf *r)
+struct ringbuf_entry * ringbuf_add(struct ringbuf *r, uint32_t sec, uint32_t usec)
 {
-	struct timeval t;
 	struct ringbuf_entry *e;
 
-	gettimeofday(&t, NULL);
-
 	e = r->buf + (r->fill++ * r->slen);
 	r->fill %= r->len;
 
-	memset(e, 0, r->slen);
-
-	e->sec = t.tv_sec;
-	e->usec = t.tv_usec;
+	/* only the header is rewritten, the caller overwrites the first
+	 * e->len payload bytes and nothing beyond is ever read back */
+	e->sec = sec;
+	e->usec = usec;
 
 	return e;
 }
@@ -254,6 +432,34 @@ void ringbuf_free(struct ringbuf *r)
 }
 
 
+int ringbuf_dump(struct ringbuf *r, const char *path)
+{
+	int i, n;
+	FILE *o;
+	struct ringbuf_entry *e;
+
+	if (!(o = fopen(path, "w")))
+		return -1;
+
+	write_pcap_header(o);
+
+	for (i = 0, n = 0; i < r->len; i++)
+	{
+		if (!(e = ringbuf_get(r, i)))
+			continue;
+
+		write_pcap_frame(o, &(e->sec), &(e->usec), e->len, e->olen);
+		fwrite((void *)e + sizeof(*e), 1, e->len, o);
+		n++;
+	}
+
+	if (fclose(o))
+		return -1;
+
+	return n;
+}
+
+
 void msg(const char *fmt, ...)
 {
 	va_list ap;
@@ -271,8 +477,17 @@ void msg(const char *fmt, ...)
 int main(int argc, char **argv)
 {
 	int i, n;
-	struct ringbuf *ring;
+	pid_t dump_pid = -1;
+	uint32_t dump_dropped = 0;
+	struct ringbuf *ring = NULL;
 	struct ringbuf_entry *e;
+	struct capture_ring cring;
+	struct tpacket_block_desc *bd;
+	struct tpacket3_hdr *ppd;
+	struct pollfd pfd;
+	struct iovec iov[STREAM_BATCH * 2];
+	pcaprec_hdr_t fhdr[STREAM_BATCH];
+	int nframes;
 	struct sockaddr_ll local = {
 		.sll_family   = AF_PACKET,
 		.sll_protocol = htons(ETH_P_ALL)
@@ -281,10 +496,8 @@ int main(int argc, char **argv)
 	radiotap_hdr_t *rhdr;
 
 	uint8_t frametype;
-	uint8_t pktbuf[0xFFFF];
-	ssize_t pktlen;
-
-	FILE *o;
+	uint8_t *pktbuf;
+	uint32_t pktlen;
 
 	int opt;
 
@@ -433,6 +646,17 @@ int main(int argc, char **argv)
 		return 7;
 	}
 
+	if (attach_filter(filter_data, filter_beacon, streaming ? 0xFFFF : pktcap))
+		msg("Unable to attach socket filter, filtering in userspace: %s\n",
+			strerror(errno));
+
+	if (setup_capture_ring(&cring))
+	{
+		msg("Unable to set up capture ring: %s\n",
+			strerror(errno));
+		return 9;
+	}
+
 	if (!streaming)
 	{
 		if (!foreground)
@@ -472,6 +696,7 @@ int main(int argc, char **argv)
 		msg(" * Dumping data to file %s\n", output);
 
 		signal(SIGUSR1, sig_dump);
+		signal(SIGCHLD, sig_child);
 	}
 	else
 	{
@@ -487,96 +712,176 @@ int main(int argc, char **argv)
 
 	promisc = set_promisc(1);
 
+	pfd.fd = capture_sock;
+	pfd.events = POLLIN | POLLERR;
+
 	/* capture loop */
 	while (1)
 	{
-		if (run_dump)
+		if (run_dump && dump_pid > 0)
+		{
+			msg("Dump to %s still in progress, ignoring request\n", output);
+			run_dump = 0;
+		}
+		else if (run_dump)
 		{
 			msg("Dumping ring to %s ...\n", output);
 
-			if (!(o = fopen(output, "w")))
-			{
-				msg("Unable to open %s: %s\n",
-					output, strerror(errno));
-			}
-			else
+			update_stats();
+			dump_dropped = frames_dropped;
+
+			/* Write the dump from a forked copy-on-write snapshot of the
+			 * ring, so that capturing continues while the file is written */
+			switch ((dump_pid = fork()))
 			{
-				write_pcap_header(o);
+			case -1:
+				msg("Unable to fork dump process: %s\n", strerror(errno));
+				break;
 
-				/* sig_dump packet buffer */
-				for (i = 0, n = 0; i < ring->len; i++)
+			case 0:
+				if ((n = ringbuf_dump(ring, output)) < 0)
 				{
-					if (!(e = ringbuf_get(ring, i)))
-						continue;
-
-					write_pcap_frame(o, &(e->sec), &(e->usec), e->len, e->olen);
-					fwrite((void *)e + sizeof(*e), 1, e->len, o);
-					n++;
+					msg("Unable to write %s: %s\n", output, strerror(errno));
+					_exit(1);
 				}
 
-				fclose(o);
-
 				msg(" * %d frames captured\n", frames_captured);
 				msg(" * %d frames filtered\n", frames_filtered);
+				msg(" * %d frames dropped\n", frames_dropped);
 				msg(" * %d frames dumped\n", n);
+				_exit(0);
 			}
 
 			run_dump = 0;
 		}
+		if (run_reap)
+		{
+			run_reap = 0;
+
+			if (dump_pid > 0 && waitpid(dump_pid, NULL, WNOHANG) == dump_pid)
+			{
+				update_stats();
+
+				msg(" * %d frames dropped during dump\n",
+					frames_dropped - dump_dropped);
+
+				dump_pid = -1;
+			}
+		}
 		if (run_stop)
 		{
 			msg("Shutting down ...\n");
 
+			if (streaming)
+			{
+				update_stats();
+
+				msg(" * %d frames captured\n", frames_captured);
+				msg(" * %d frames dropped\n", frames_dropped);
+			}
+
+			if (dump_pid > 0)
+				waitpid(dump_pid, NULL, 0);
+
 			if (promisc)
 				set_promisc(0);
 
 			if (ring)
 				ringbuf_free(ring);
 
+			capture_ring_free(&cring);
+
 			return 0;
 		}
 
-		pktlen = recvfrom(capture_sock, pktbuf, sizeof(pktbuf), 0, NULL, 0);
-		frames_captured++;
-
-		/* check received frametype, if we should filter it, rewind the ring */
-		rhdr = (radiotap_hdr_t *)pktbuf;
-
-		if (pktlen <= sizeof(radiotap_hdr_t) || le16(rhdr->it_len) >= pktlen)
+		if (!(bd = capture_ring_next(&cring)))
 		{
-			frames_filtered++;
+			if (poll(&pfd, 1, 1000) < 0 && errno != EINTR)
+			{
+				msg("Unable to poll socket: %s\n", strerror(errno));
+				run_stop = 1;
+			}
+
 			continue;
 		}
 
-		frametype = *(uint8_t *)(pktbuf + le16(rhdr->it_len));
-
-		if ((filter_data   && (frametype & FRAMETYPE_MASK) == FRAMETYPE_DATA) ||
-		    (filter_beacon && (frametype & FRAMETYPE_MASK) == FRAMETYPE_BEACON))
+		if (streaming && !header_written)
 		{
-			frames_filtered++;
-			continue;
+			write_pcap_header(stdout);
+			fflush(stdout);
+			header_written = 1;
 		}
 
-		if (streaming)
+		ppd = (struct tpacket3_hdr *)
+			((uint8_t *)bd + bd->hdr.bh1.offset_to_first_pkt);
+
+		for (i = 0, nframes = 0; i < bd->hdr.bh1.num_pkts; i++,
+		     ppd = (struct tpacket3_hdr *)((uint8_t *)ppd + ppd->tp_next_offset))
 		{
-			if (!header_written)
+			frames_captured++;
+
+			pktbuf = (uint8_t *)ppd + ppd->tp_mac;
+			pktlen = ppd->tp_snaplen;
+
+			/* check received frametype, the socket filter should already
+			 * have dropped unwanted frames unless it failed to attach */
+			rhdr = (radiotap_hdr_t *)pktbuf;
+
+			/* judge the frame by its length on air, the snaplen may
+			 * cut it off anywhere behind the radiotap header */
+			if (ppd->tp_len <= sizeof(radiotap_hdr_t) ||
+			    le16(rhdr->it_len) >= ppd->tp_len)
 			{
-				write_pcap_header(stdout);
-				header_written = 1;
+				frames_filtered++;
+				continue;
 			}
 
-			write_pcap_frame(stdout, NULL, NULL, pktlen, pktlen);
-			fwrite(pktbuf, 1, pktlen, stdout);
-			fflush(stdout);
-		}
-		else
-		{
-			e = ringbuf_add(ring);
-			e->olen = pktlen;
-			e->len = (pktlen > pktcap) ? pktcap : pktlen;
+			if (le16(rhdr->it_len) < pktlen)
+			{
+				frametype = *(uint8_t *)(pktbuf + le16(rhdr->it_len));
+
+				if ((filter_data   && (frametype & FRAMETYPE_MASK) == FRAMETYPE_DATA) ||
+				    (filter_beacon && (frametype & FRAMETYPE_MASK) == FRAMETYPE_BEACON))
+				{
+					frames_filtered++;
+					continue;
+				}
+			}
+
+			if (streaming)
+			{
+				fhdr[nframes].ts_sec   = ppd->tp_sec;
+				fhdr[nframes].ts_usec  = ppd->tp_nsec / 1000;
+				fhdr[nframes].incl_len = pktlen;
+				fhdr[nframes].orig_len = ppd->tp_len;
 
-			memcpy((void *)e + sizeof(*e), pktbuf, e->len);
+				iov[nframes * 2].iov_base     = &fhdr[nframes];
+				iov[nframes * 2].iov_len      = sizeof(fhdr[nframes]);
+				iov[nframes * 2 + 1].iov_base = pktbuf;
+				iov[nframes * 2 + 1].iov_len  = pktlen;
+
+				if (++nframes == STREAM_BATCH)
+				{
+					if (writev_all(1, iov, nframes * 2))
+						run_stop = 1;
+
+					nframes = 0;
+				}
+			}
+			else
+			{
+				e = ringbuf_add(ring, ppd->tp_sec, ppd->tp_nsec / 1000);
+				e->olen = ppd->tp_len;
+				e->len = (pktlen > pktcap) ? pktcap : pktlen;
+
+				memcpy((void *)e + sizeof(*e), pktbuf, e->len);
+			}
 		}
+
+		if (nframes > 0 && writev_all(1, iov, nframes * 2))
+			run_stop = 1;
+
+		capture_ring_release(&cring, bd);
 	}
 
 	return 0;
@@ -19,6 +19,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdint.h>
+#include <errno.h>
 #include <stdio.h>
 #include <fcntl.h>
 #include <stdlib.h>
@@ -38,8 +39,16 @@
 # define CLEANMARKER "\x85\x19\x03\x20\x0c\x00\x00\x00\xb1\xb0\x1e\xe4"
 #endif
 
+/* eraseblocks are collected in a batch buffer and erased/written together */
+#define JFFS2_BATCH_SIZE	(256 * 1024)
+/* a data node never covers more than one page of file data */
+#define JFFS2_PAGE_SIZE	4096
+
 static int last_ino = 0;
 static int last_version = 0;
+static char *batch = NULL;
+static int batch_blocks = 0;
+static int batch_fill = 0;
 static char *buf = NULL;
 static int ofs = 0;
 static int outfd = -1;
@@ -48,17 +57,33 @@ static int target_ino = 0;
 
 static void prep_eraseblock(void);
 
-static void pad(int size)
+static int alloc_batch(void)
 {
-	if ((ofs % size == 0) && (ofs < erasesize))
-		return;
+	batch_blocks = JFFS2_BATCH_SIZE / erasesize;
+	if (batch_blocks < 1)
+		batch_blocks = 1;
 
-	if (ofs < erasesize) {
-		memset(buf + ofs, 0xff, (size - (ofs % size)));
-		ofs += (size - (ofs % size));
-	}
-	ofs = ofs % erasesize;
-	if (ofs == 0) {
+	batch = malloc(batch_blocks * erasesize);
+	if (!batch)
+		return -1;
+
+	batch_fill = 0;
+	buf = batch;
+	return 0;
+}
+
+static void free_batch(void)
+{
+	free(batch);
+	batch = buf = NULL;
+}
+
+static void flush_batch(void)
+{
+	char *p = batch;
+	int run;
+
+	while (batch_fill > 0) {
 		while (mtd_block_is_bad(outfd, mtdofs) && (mtdofs < mtdsize)) {
 			if (!quiet)
 				fprintf(stderr, "\nSkipping bad block at 0x%08x   ", mtdofs);
@@ -68,9 +93,50 @@ static void pad(int size)
 			/* Move the file pointer along over the bad block. */
 			lseek(outfd, erasesize, SEEK_CUR);
 		}
-		mtd_erase_block(outfd, mtdofs);
-		write(outfd, buf, erasesize);
-		mtdofs += erasesize;
+
+		/* erase and write the run of good blocks in one go */
+		for (run = 1; run < batch_fill; run++) {
+			int next = mtdofs + run * erasesize;
+
+			if ((next >= mtdsize) || mtd_block_is_bad(outfd, next))
+				break;
+		}
+
+		/* give up on the first error, like mtd_write() does, and tell
+		 * which part of the partition was left inconsistent */
+		if (mtd_erase_range(outfd, mtdofs, run * erasesize)) {
+			fprintf(stderr, "\nFailed to erase 0x%08x-0x%08x: %s\n",
+				mtdofs, mtdofs + run * erasesize, strerror(errno));
+			exit(1);
+		}
+		if (write(outfd, p, run * erasesize) != run * erasesize) {
+			fprintf(stderr, "\nFailed to write 0x%08x-0x%08x: %s\n",
+				mtdofs, mtdofs + run * erasesize, strerror(errno));
+			exit(1);
+		}
+		mtdofs += run * erasesize;
+		p += run * erasesize;
+		batch_fill -= run;
+	}
+
+	buf = batch;
+}
+
+static void pad(int size)
+{
+	if ((ofs % size == 0) && (ofs < erasesize))
+		return;
+
+	if (ofs < erasesize) {
+		memset(buf + ofs, 0xff, (size - (ofs % size)));
+		ofs += (size - (ofs % size));
+	}
+	ofs = ofs % erasesize;
+	if (ofs == 0) {
+		if (++batch_fill == batch_blocks)
+			flush_batch();
+		else
+			buf = batch + batch_fill * erasesize;
 	}
 }
 
@@ -160,12 +226,50 @@ static int add_dir(const char *name, int parent)
 	return inode;
 }
 
+/* same format as the kernel rtime compressor, may consume less than srclen */
+static int rtime_compress(const unsigned char *src, unsigned char *dst,
+			  int *srclen, int *dstlen)
+{
+	unsigned short positions[256];
+	int outpos = 0, pos = 0;
+
+	if (*dstlen <= 3)
+		return -1;
+
+	memset(positions, 0, sizeof(positions));
+	while (pos < *srclen && outpos <= *dstlen - 2) {
+		int backpos, runlen = 0;
+		unsigned char value;
+
+		value = src[pos];
+		dst[outpos++] = src[pos++];
+		backpos = positions[value];
+		positions[value] = pos;
+
+		while ((backpos < pos) && (pos < *srclen) &&
+		       (src[pos] == src[backpos++]) && (runlen < 255)) {
+			pos++;
+			runlen++;
+		}
+		dst[outpos++] = runlen;
+	}
+
+	if (outpos >= pos)
+		return -1;
+
+	*srclen = pos;
+	*dstlen = outpos;
+	return 0;
+}
+
 static void add_file(const char *name, int parent)
 {
 	int inode, f_offset = 0, fd;
 	struct jffs2_raw_inode ri;
 	struct stat st;
-	char wbuf[4096];
+	static unsigned char rbuf[64 * 1024];
+	unsigned char cbuf[JFFS2_PAGE_SIZE];
+	int rpos = 0, rlen = 0;
 	const char *fname;
 
 	if (stat(name, &st)) {
@@ -201,7 +305,8 @@ static void add_file(const char *name, int parent)
 	}
 
 	for (;;) {
-		int len = 0;
+		unsigned char *data;
+		int len = 0, dsize, csize;
 
 		for (;;) {
 			len = rbytes() - sizeof(ri);
@@ -212,23 +317,42 @@ static void add_file(const char *name, int parent)
 			prep_eraseblock();
 		}
 
-		if (len > sizeof(wbuf))
-			len = sizeof(wbuf);
+		if (rpos == rlen) {
+			rlen = read(fd, rbuf, sizeof(rbuf));
+			if (rlen <= 0)
+				break;
+			rpos = 0;
+		}
 
-		len = read(fd, wbuf, len);
-		if (len <= 0)
-			break;
+		/* keep data nodes aligned to page boundaries */
+		dsize = JFFS2_PAGE_SIZE - (f_offset % JFFS2_PAGE_SIZE);
+		if (dsize > rlen - rpos)
+			dsize = rlen - rpos;
+
+		csize = (len < dsize) ? len : dsize - 1;
+		if (!rtime_compress(rbuf + rpos, cbuf, &dsize, &csize)) {
+			ri.compr = JFFS2_COMPR_RTIME;
+			data = cbuf;
+		} else {
+			if (dsize > len)
+				dsize = len;
+			csize = dsize;
+			ri.compr = JFFS2_COMPR_NONE;
+			data = rbuf + rpos;
+		}
 
-		ri.totlen = sizeof(ri) + len;
+		ri.totlen = sizeof(ri) + csize;
 		ri.hdr_crc = crc32(0, &ri, sizeof(struct jffs2_unknown_node) - 4);
 		ri.version = ++last_version;
 		ri.offset = f_offset;
-		ri.csize = ri.dsize = len;
+		ri.csize = csize;
+		ri.dsize = dsize;
 		ri.node_crc = crc32(0, &ri, sizeof(ri) - 8);
-		ri.data_crc = crc32(0, wbuf, len);
-		f_offset += len;
+		ri.data_crc = crc32(0, data, csize);
+		f_offset += dsize;
+		rpos += dsize;
 		add_data((char *) &ri, sizeof(ri));
-		add_data(wbuf, len);
+		add_data((char *) data, csize);
 		pad(4);
 		prep_eraseblock();
 	}
@@ -241,7 +365,10 @@ int mtd_replace_jffs2(const char *mtd, int fd, int ofs, const char *filename)
 	outfd = fd;
 	mtdofs = ofs;
 
-	buf = malloc(erasesize);
+	if (alloc_batch()) {
+		fprintf(stderr, "Out of memory!\n");
+		return 0;
+	}
 	target_ino = 1;
 	if (!last_ino)
 		last_ino = 1;
@@ -251,7 +378,8 @@ int mtd_replace_jffs2(const char *mtd, int fd, int ofs, const char *filename)
 	/* add eof marker, pad to eraseblock size and write the data */
 	add_data(JFFS2_EOF, sizeof(JFFS2_EOF) - 1);
 	pad(erasesize);
-	free(buf);
+	flush_batch();
+	free_batch();
 
 	return (mtdofs - ofs);
 }
@@ -294,8 +422,7 @@ int mtd_write_jffs2(const char *mtd, const char *filename, const char *dir)
 	if (quiet < 2)
 		fprintf(stderr, "Appending %s to jffs2 partition %s\n", filename, mtd);
 	
-	buf = malloc(erasesize);
-	if (!buf) {
+	if (alloc_batch()) {
 		fprintf(stderr, "Out of memory!\n");
 		goto done;
 	}
@@ -350,6 +477,7 @@ int mtd_write_jffs2(const char *mtd, const char *filename, const char *dir)
 	/* add eof marker, pad to eraseblock size and write the data */
 	add_data(JFFS2_EOF, sizeof(JFFS2_EOF) - 1);
 	pad(erasesize);
+	flush_batch();
 
 	err = 0;
 
@@ -359,8 +487,7 @@ int mtd_write_jffs2(const char *mtd, const char *filename, const char *dir)
 
 done:
 	close(outfd);
-	if (buf)
-		free(buf);
+	free_batch();
 
 	return err;
 }
@@ -96,6 +96,15 @@ int jffs2_skip_bytes=0;
 int mtdtype = 0;
 uint32_t opt_trxmagic = TRX_MAGIC;
 
+/* bad block cache, one entry per eraseblock of the last checked device */
+enum {
+	BLOCK_UNKNOWN,
+	BLOCK_GOOD,
+	BLOCK_BAD,
+};
+static uint8_t *block_state;
+static int block_count;
+
 int mtd_open(const char *mtd, bool block)
 {
 	FILE *fp;
@@ -144,32 +153,52 @@ int mtd_check_open(const char *mtd)
 	erasesize = mtdInfo.erasesize;
 	mtdtype = mtdInfo.type;
 
+	free(block_state);
+	block_state = NULL;
+	block_count = 0;
+	if (mtdtype == MTD_NANDFLASH && erasesize > 0) {
+		block_count = mtdsize / erasesize;
+		block_state = calloc(block_count, sizeof(*block_state));
+	}
+
 	return fd;
 }
 
 int mtd_block_is_bad(int fd, int offset)
 {
 	int r = 0;
+	int block = -1;
 	loff_t o = offset;
 
 	if (mtdtype == MTD_NANDFLASH)
 	{
+		/* the bad block table does not change while we write, so only
+		 * ask the driver once per eraseblock */
+		if (block_state && offset >= 0 && offset / erasesize < block_count) {
+			block = offset / erasesize;
+			if (block_state[block] != BLOCK_UNKNOWN)
+				return block_state[block] == BLOCK_BAD;
+		}
+
 		r = ioctl(fd, MEMGETBADBLOCK, &o);
 		if (r < 0)
 		{
 			fprintf(stderr, "Failed to get erase block status\n");
 			exit(1);
 		}
+
+		if (block >= 0)
+			block_state[block] = r ? BLOCK_BAD : BLOCK_GOOD;
 	}
 	return r;
 }
 
-int mtd_erase_block(int fd, int offset)
+int mtd_erase_range(int fd, int offset, int length)
 {
 	struct erase_info_user mtdEraseInfo;
 
 	mtdEraseInfo.start = offset;
-	mtdEraseInfo.length = erasesize;
+	mtdEraseInfo.length = length;
 	ioctl(fd, MEMUNLOCK, &mtdEraseInfo);
 	if (ioctl (fd, MEMERASE, &mtdEraseInfo) < 0)
 		return -1;
@@ -177,6 +206,11 @@ int mtd_erase_block(int fd, int offset)
 	return 0;
 }
 
+int mtd_erase_block(int fd, int offset)
+{
+	return mtd_erase_range(fd, offset, erasesize);
+}
+
 int mtd_write_buffer(int fd, const char *buf, int offset, int length)
 {
 	lseek(fd, offset, SEEK_SET);
@@ -696,6 +730,24 @@ resume:
 				exit(1);
 			}
 		}
+
+		/* keep the checksum state of the untouched image data, so that
+		 * the header fixup only has to rehash the appended jffs2 data */
+		if (!jffs2_replaced && !skip_bad_blocks && !part_offset &&
+		    !offset && (mtd == str || !str)) {
+			switch (imageformat) {
+			case MTD_IMAGE_FORMAT_TRX:
+				if (trx_hash_image)
+					trx_hash_image(buf, w, buflen);
+				break;
+			case MTD_IMAGE_FORMAT_SEAMA:
+				if (seama_hash_image)
+					seama_hash_image(buf, w, buflen);
+				break;
+			default:
+				break;
+			}
+		}
 		w += buflen;
 
 #ifdef FIS_SUPPORT
@@ -23,6 +23,7 @@
  */
 
 #include <endian.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
@@ -48,9 +49,55 @@
 #error unknown endianness!
 #endif
 
+#define SEAMA_BUF_SIZE	(64 * 1024)
+
 ssize_t pread(int fd, void *buf, size_t count, off_t offset);
 ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset);
 
+/* MD5 state of the image data as it was written by mtd_write() */
+static struct {
+	bool valid;
+	size_t data_offset;
+	size_t data_size;
+	size_t offset;
+	MD5_CTX ctx;
+} seama_mid;
+
+void
+seama_hash_image(const char *buf, size_t offset, size_t len)
+{
+	const struct seama_entity_header *shdr = (const struct seama_entity_header *) buf;
+	size_t start, end;
+
+	if (offset == 0) {
+		seama_mid.valid = (len >= sizeof(*shdr) &&
+				   shdr->magic == htonl(SEAMA_MAGIC));
+		if (!seama_mid.valid)
+			return;
+
+		seama_mid.data_offset = sizeof(*shdr) + ntohs(shdr->metasize);
+		seama_mid.data_size = ntohl(shdr->size);
+		seama_mid.offset = 0;
+		MD5_Init(&seama_mid.ctx);
+	}
+
+	if (!seama_mid.valid || offset != seama_mid.offset) {
+		seama_mid.valid = false;
+		return;
+	}
+
+	start = offset;
+	if (start < seama_mid.data_offset)
+		start = seama_mid.data_offset;
+	end = offset + len;
+	if (end > seama_mid.data_offset + seama_mid.data_size)
+		end = seama_mid.data_offset + seama_mid.data_size;
+	if (start < end)
+		MD5_Update(&seama_mid.ctx, (unsigned char *) buf + start - offset,
+			   end - start);
+	seama_mid.offset = offset + len;
+}
+
 int
 seama_fix_md5(struct seama_entity_header *shdr, int fd, size_t data_offset, size_t data_size)
 {
@@ -58,30 +105,50 @@ seama_fix_md5(struct seama_entity_header *shdr, int fd, size_t data_offset, size
 	ssize_t res;
 	MD5_CTX ctx;
 	unsigned char digest[16];
+	size_t ofs, end, len;
 	int i;
 	int err = 0;
 
-	buf = malloc(data_size);
+	buf = malloc(SEAMA_BUF_SIZE);
 	if (!buf) {
 		err = -ENOMEM;
 		goto err_out;
 	}
 
-	res = pread(fd, buf, data_size, data_offset);
-	if (res != data_size) {
-		perror("pread");
-		err = -EIO;
-		goto err_free;
+	/* only the data behind the part hashed during the write can have
+	 * changed, so resume from there if possible */
+	ofs = data_offset;
+	end = data_offset + data_size;
+	if (seama_mid.valid && seama_mid.data_offset == data_offset &&
+	    seama_mid.offset >= data_offset && seama_mid.offset <= end) {
+		ctx = seama_mid.ctx;
+		ofs = seama_mid.offset;
+	} else {
+		MD5_Init(&ctx);
 	}
 
-	MD5_Init(&ctx);
-	MD5_Update(&ctx, buf, data_size);
+	while (ofs < end) {
+		len = end - ofs;
+		if (len > SEAMA_BUF_SIZE)
+			len = SEAMA_BUF_SIZE;
+
+		res = pread(fd, buf, len, ofs);
+		if (res != len) {
+			perror("pread");
+			err = -EIO;
+			goto err_free;
+		}
+
+		MD5_Update(&ctx, (unsigned char *) buf, len);
+		ofs += len;
+	}
 	MD5_Final(digest, &ctx);
 
 	if (!memcmp(digest, shdr->md5, sizeof(digest))) {
 		if (quiet < 2)
 			fprintf(stderr, "the header is fixed already\n");
-		return -1;
+		err = -1;
+		goto err_free;
 	}
 
 	if (quiet < 2) {
@@ -159,7 +226,7 @@ mtd_fixseama(const char *mtd, size_t offset, size_t data_size)
 		data_size = mtdsize - data_offset;
 	if (data_size > ntohl(shdr->size))
 		data_size = ntohl(shdr->size);
-	if (seama_fix_md5(shdr, fd, data_offset, data_size))
+	if (seama_fix_md5(shdr, fd, block_offset + data_offset, data_size))
 		goto out;
 
 	if (mtd_erase_block(fd, block_offset)) {
@@ -19,16 +19,17 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
  */
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
 #include <unistd.h>
 #include <fcntl.h>
-#include <sys/mman.h>
 #include <sys/stat.h>
 #include <endian.h>
 #include <string.h>
 #include <errno.h>
+#include <arpa/inet.h>
 
 #include <sys/ioctl.h>
 #include <mtd/mtd-user.h>
@@ -37,6 +38,7 @@
 
 #define TRX_CRC32_DATA_OFFSET	12	/* First 12 bytes are not covered by CRC32 */
 #define TRX_CRC32_DATA_SIZE	16
+#define TRX_BUF_SIZE		(64 * 1024)
 struct trx_header {
 	uint32_t magic;		/* "HDR0" */
 	uint32_t len;		/* Length of file including header */
@@ -62,13 +64,48 @@ struct trx_header {
 ssize_t pread(int fd, void *buf, size_t count, off_t offset);
 ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset);
 
+/* CRC32 state of the image data as it was written by mtd_write() */
+static struct {
+	bool valid;
+	uint32_t len;
+	size_t offset;
+	uint32_t crc32;
+} trx_mid;
+
+void
+trx_hash_image(const char *buf, size_t offset, size_t len)
+{
+	const struct trx_header *trx = (const struct trx_header *) buf;
+	size_t start = 0, end;
+
+	if (offset == 0) {
+		trx_mid.valid = (len >= sizeof(*trx) &&
+				 ntohl(trx->magic) == opt_trxmagic);
+		trx_mid.len = trx->len;
+		trx_mid.offset = 0;
+		trx_mid.crc32 = 0xffffffff;
+		start = TRX_CRC32_DATA_OFFSET;
+	}
+
+	if (!trx_mid.valid || offset != trx_mid.offset) {
+		trx_mid.valid = false;
+		return;
+	}
+
+	end = min(offset + len, (size_t) trx_mid.len);
+	if (offset + start < end)
+		trx_mid.crc32 = crc32(trx_mid.crc32, buf + start, end - offset - start);
+	trx_mid.offset = offset + len;
+}
+
 int
 trx_fixup(int fd, const char *name)
 {
 	struct mtd_info_user mtdInfo;
-	unsigned long len;
-	struct trx_header *trx;
-	void *ptr, *scan;
+	struct trx_header trx;
+	size_t ofs, len;
+	uint32_t crc;
+	char *buf;
 	int bfd;
 
 	if (ioctl(fd, MEMGETINFO, &mtdInfo) < 0) {
@@ -76,30 +113,66 @@ trx_fixup(int fd, const char *name)
 		goto err;
 	}
 
-	len = mtdInfo.size;
 	if (mtdInfo.size <= 0) {
 		fprintf(stderr, "Invalid MTD device size\n");
 		goto err;
 	}
 
 	bfd = mtd_open(name, true);
-	ptr = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, bfd, 0);
-	if (!ptr || (ptr == (void *) -1)) {
-		perror("mmap");
-		fprintf(stderr, "Mapping the TRX header failed\n");
+	if (bfd < 0) {
+		fprintf(stderr, "Could not open mtd block device: %s\n", name);
+		goto err;
+	}
+
+	if (pread(bfd, &trx, sizeof(trx), 0) != sizeof(trx)) {
+		perror("pread");
 		goto err1;
 	}
 
-	trx = ptr;
-	if (ntohl(trx->magic) != opt_trxmagic) {
+	if (ntohl(trx.magic) != opt_trxmagic) {
 		fprintf(stderr, "TRX header not found\n");
-		goto err;
+		goto err1;
+	}
+
+	if (trx.len > mtdInfo.size || trx.len < sizeof(trx)) {
+		fprintf(stderr, "Invalid TRX length\n");
+		goto err1;
+	}
+
+	/* only the data behind the part hashed during the write can have
+	 * changed, so resume from there if possible */
+	ofs = offsetof(struct trx_header, flag_version);
+	crc = 0xffffffff;
+	if (trx_mid.valid && trx_mid.len == trx.len) {
+		ofs = min(trx_mid.offset, (size_t) trx.len);
+		crc = trx_mid.crc32;
+	}
+
+	buf = malloc(TRX_BUF_SIZE);
+	if (!buf) {
+		perror("malloc");
+		goto err1;
+	}
+
+	while (ofs < trx.len) {
+		len = min((size_t) TRX_BUF_SIZE, trx.len - ofs);
+		if (pread(bfd, buf, len, ofs) != len) {
+			perror("pread");
+			free(buf);
+			goto err1;
+		}
+		crc = crc32(crc, buf, len);
+		ofs += len;
 	}
+	free(buf);
 
-	scan = ptr + offsetof(struct trx_header, flag_version);
-	trx->crc32 = crc32buf(scan, trx->len - (scan - ptr));
-	msync(ptr, sizeof(struct trx_header), MS_SYNC|MS_INVALIDATE);
-	munmap(ptr, len);
+	trx.crc32 = crc;
+	if (pwrite(bfd, &trx.crc32, sizeof(trx.crc32),
+		   offsetof(struct trx_header, crc32)) != sizeof(trx.crc32)) {
+		perror("pwrite");
+		goto err1;
+	}
+	fsync(bfd);
 	close(bfd);
 	return 0;
 
@@ -160,9 +233,11 @@ mtd_fixtrx(const char *mtd, size_t offset, size_t data_size)
 	int fd;
 	struct trx_header *trx;
 	char *first_block;
-	char *buf, *to;
+	char *buf;
 	ssize_t res;
 	size_t block_offset;
+	size_t read_size = 0;
+	uint32_t crc = 0xffffffff;
 
 	if (quiet < 2)
 		fprintf(stderr, "Trying to fix trx header in %s at 0x%x...\n", mtd, offset);
@@ -205,37 +280,39 @@ mtd_fixtrx(const char *mtd, size_t offset, size_t data_size)
 		exit(1);
 	}
 
-	buf = malloc(data_size);
+	buf = malloc(TRX_BUF_SIZE);
 	if (!buf) {
 		perror("malloc");
 		exit(1);
 	}
 
-	to = buf;
 	while (data_size) {
 		size_t read_block_offset = data_offset & ~(erasesize - 1);
 		size_t read_chunk;
 
 		read_chunk = erasesize - (data_offset & (erasesize - 1));
 		read_chunk = min(read_chunk, data_size);
+		read_chunk = min(read_chunk, (size_t) TRX_BUF_SIZE);
 
 		/* Read from good blocks only to match CFE behavior */
 		if (!mtd_block_is_bad(fd, read_block_offset)) {
-			res = pread(fd, to, read_chunk, data_offset);
+			res = pread(fd, buf, read_chunk, data_offset);
 			if (res != read_chunk) {
 				perror("pread");
 				exit(1);
 			}
-			to += read_chunk;
+			crc = crc32(crc, buf, read_chunk);
+			read_size += read_chunk;
 		}
 
 		data_offset += read_chunk;
 		data_size -= read_chunk;
 	}
-	data_size = to - buf;
+	free(buf);
+	data_size = read_size;
 
 	if (trx->len == STORE32_LE(data_size + TRX_CRC32_DATA_OFFSET) &&
-	    trx->crc32 == STORE32_LE(crc32buf(buf, data_size))) {
+	    trx->crc32 == STORE32_LE(crc)) {
 		if (quiet < 2)
 			fprintf(stderr, "Header already fixed, exiting\n");
 		close(fd);
@@ -244,7 +321,7 @@ mtd_fixtrx(const char *mtd, size_t offset, size_t data_size)
 
 	trx->len = STORE32_LE(data_size + offsetof(struct trx_header, flag_version));
 
-	trx->crc32 = STORE32_LE(crc32buf(buf, data_size));
+	trx->crc32 = STORE32_LE(crc);
 	if (mtd_erase_block(fd, block_offset)) {
 		fprintf(stderr, "Can't erease block at 0x%x (%s)\n", block_offset, strerror(errno));
 		exit(1);
@@ -12,6 +12,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -57,6 +58,8 @@
 
 #define UBI_EC_HDR_MAGIC		0x55424923
 
+#define BCM4908IMG_BUF_SIZE		0x10000
+
 static int debug;
 
 struct bcm4908img_tail {
@@ -87,6 +90,8 @@ struct bcm4908img_info {
 	size_t tail_offset;
 	uint32_t crc32;			/* Calculated checksum */
 	struct bcm4908img_tail tail;
+	const uint8_t *data;		/* Whole file mapping */
+	size_t file_size;
 };
 
 char *pathname;
@@ -178,6 +183,60 @@ uint32_t bcm4908img_crc32(uint32_t crc, const void *buf, size_t len) {
 	return crc;
 }
 
+static uint32_t bcm4908img_gf2_times(const uint32_t *mat, uint32_t vec) {
+	uint32_t sum = 0;
+
+	for (; vec; vec >>= 1, mat++) {
+		if (vec & 1)
+			sum ^= *mat;
+	}
+
+	return sum;
+}
+
+static void bcm4908img_gf2_square(uint32_t *square, const uint32_t *mat) {
+	int n;
+
+	for (n = 0; n < 32; n++)
+		square[n] = bcm4908img_gf2_times(mat, mat[n]);
+}
+
+/*
+ * Advance crc as if length zero bytes were fed into it. Takes O(log length)
+ * so a checksum can be patched after changing a few bytes without rereading
+ * everything that follows them.
+ */
+static uint32_t bcm4908img_crc32_zeros(uint32_t crc, size_t length) {
+	uint32_t even[32];
+	uint32_t odd[32];
+	uint32_t row = 1;
+	int n;
+
+	odd[0] = 0xedb88320;
+	for (n = 1; n < 32; n++) {
+		odd[n] = row;
+		row <<= 1;
+	}
+	bcm4908img_gf2_square(even, odd);
+	bcm4908img_gf2_square(odd, even);
+
+	while (length) {
+		bcm4908img_gf2_square(even, odd);
+		if (length & 1)
+			crc = bcm4908img_gf2_times(even, crc);
+		length >>= 1;
+		if (!length)
+			break;
+
+		bcm4908img_gf2_square(odd, even);
+		if (length & 1)
+			crc = bcm4908img_gf2_times(odd, crc);
+		length >>= 1;
+	}
+
+	return crc;
+}
+
 /**************************************************
  * Helpers
  **************************************************/
@@ -211,26 +270,10 @@ static void bcm4908img_close(FILE *fp) {
 		fclose(fp);
 }
 
-static int bcm4908img_calc_crc32(FILE *fp, struct bcm4908img_info *info) {
-	uint8_t buf[1024];
-	size_t length;
-	size_t bytes;
-
-	/* Start with cferom (or bootfs) - skip vendor header */
-	fseek(fp, info->cferom_offset, SEEK_SET);
-
-	info->crc32 = 0xffffffff;
-	length = info->tail_offset - info->cferom_offset;
-	while (length && (bytes = fread(buf, 1, bcm4908img_min(sizeof(buf), length), fp)) > 0) {
-		info->crc32 = bcm4908img_crc32(info->crc32, buf, bytes);
-		length -= bytes;
-	}
-	if (length) {
-		fprintf(stderr, "Failed to read last %zd B of data\n", length);
-		return -EIO;
-	}
-
-	return 0;
+static void bcm4908img_unmap(struct bcm4908img_info *info) {
+	if (info->data)
+		munmap((void *)info->data, info->file_size);
+	info->data = NULL;
 }
 
 /**************************************************
@@ -273,16 +316,19 @@ static bool bcm4908img_is_all_ff(const void *buf, size_t length)
 	return true;
 }
 
+/*
+ * The whole image gets mapped once and kept in info->data so every following
+ * command (ls, mv, extract) works on the same pages without seeking around.
+ */
 static int bcm4908img_parse(FILE *fp, struct bcm4908img_info *info) {
 	struct bcm4908img_tail *tail = &info->tail;
-	struct linksys_tail *linksys;
-	struct chk_header *chk;
+	const struct linksys_tail *linksys;
+	const struct chk_header *chk;
+	const uint8_t *data;
 	struct stat st;
-	uint8_t buf[1024];
 	size_t file_size;
 	uint16_t tmp16;
 	size_t length;
-	size_t bytes;
 	int err = 0;
 
 	memset(info, 0, sizeof(*info));
@@ -296,25 +342,30 @@ static int bcm4908img_parse(FILE *fp, struct bcm4908img_info *info) {
 	}
 	file_size = st.st_size;
 
+	if (file_size < 1024) {
+		fprintf(stderr, "Failed to read file header\n");
+		return -EIO;
+	}
+
+	data = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+	if (data == MAP_FAILED) {
+		err = -errno;
+		fprintf(stderr, "Failed to mmap: %d\n", err);
+		return err;
+	}
+	madvise((void *)data, file_size, MADV_SEQUENTIAL);
+	info->data = data;
+	info->file_size = file_size;
+
 	info->tail_offset = file_size - sizeof(*tail);
 
 	/* Vendor formats */
 
-	rewind(fp);
-	if (fread(buf, 1, sizeof(buf), fp) != sizeof(buf)) {
-		fprintf(stderr, "Failed to read file header\n");
-		return -EIO;
-	}
-	chk = (void *)buf;
+	chk = (const void *)data;
 	if (be32_to_cpu(chk->magic) == 0x2a23245e)
 		info->cferom_offset = be32_to_cpu(chk->header_len);
 
-	fseek(fp, -sizeof(buf), SEEK_END);
-	if (fread(buf, 1, sizeof(buf), fp) != sizeof(buf)) {
-		fprintf(stderr, "Failed to read file header\n");
-		return -EIO;
-	}
-	linksys = (void *)(buf + sizeof(buf) - sizeof(*linksys));
+	linksys = (const void *)(data + file_size - sizeof(*linksys));
 	if (!memcmp(linksys->magic, ".LINKSYS.", sizeof(linksys->magic))) {
 		info->tail_offset -= sizeof(*linksys);
 	}
@@ -324,15 +375,7 @@ static int bcm4908img_parse(FILE *fp, struct bcm4908img_info *info) {
 	for (info->bootfs_offset = info->cferom_offset;
 	     info->bootfs_offset < info->tail_offset;
 	     info->bootfs_offset += 0x20000) {
-		if (fseek(fp, info->bootfs_offset, SEEK_SET)) {
-			err = -errno;
-			fprintf(stderr, "Failed to fseek to the 0x%zx\n", info->bootfs_offset);
-			return err;
-		}
-		if (fread(&tmp16, 1, sizeof(tmp16), fp) != sizeof(tmp16)) {
-			fprintf(stderr, "Failed to read while looking for JFFS2\n");
-			return -EIO;
-		}
+		memcpy(&tmp16, data + info->bootfs_offset, sizeof(tmp16));
 		if (be16_to_cpu(tmp16) == 0x8519)
 			break;
 	}
@@ -344,25 +387,19 @@ static int bcm4908img_parse(FILE *fp, struct bcm4908img_info *info) {
 	for (info->rootfs_offset = info->bootfs_offset;
 	     info->rootfs_offset < info->tail_offset;
 	     info->rootfs_offset += 0x20000) {
-		uint32_t *magic = (uint32_t *)&buf[0];
-
-		if (fseek(fp, info->rootfs_offset, SEEK_SET)) {
-			err = -errno;
-			fprintf(stderr, "Failed to fseek: %d\n", err);
-			return err;
-		}
+		uint32_t magic;
 
-		length = info->padding_offset ? sizeof(*magic) : 256;
-		bytes = fread(buf, 1, length, fp);
-		if (bytes != length) {
+		length = info->padding_offset ? sizeof(magic) : 256;
+		if (info->rootfs_offset + length > file_size) {
 			fprintf(stderr, "Failed to read %zu bytes\n", length);
 			return -EIO;
 		}
 
-		if (!info->padding_offset && bcm4908img_is_all_ff(buf, length))
+		if (!info->padding_offset && bcm4908img_is_all_ff(data + info->rootfs_offset, length))
 			info->padding_offset = info->rootfs_offset;
 
-		if (be32_to_cpu(*magic) == UBI_EC_HDR_MAGIC)
+		memcpy(&magic, data + info->rootfs_offset, sizeof(magic));
+		if (be32_to_cpu(magic) == UBI_EC_HDR_MAGIC)
 			break;
 	}
 	if (info->rootfs_offset >= info->tail_offset) {
@@ -373,25 +410,12 @@ static int bcm4908img_parse(FILE *fp, struct bcm4908img_info *info) {
 	/* CRC32 */
 
 	/* Start with cferom (or bootfs) - skip vendor header */
-	fseek(fp, info->cferom_offset, SEEK_SET);
-
-	info->crc32 = 0xffffffff;
-	length = info->tail_offset - info->cferom_offset;
-	while (length && (bytes = fread(buf, 1, bcm4908img_min(sizeof(buf), length), fp)) > 0) {
-		info->crc32 = bcm4908img_crc32(info->crc32, buf, bytes);
-		length -= bytes;
-	}
-	if (length) {
-		fprintf(stderr, "Failed to read last %zd B of data\n", length);
-		return -EIO;
-	}
+	info->crc32 = bcm4908img_crc32(0xffffffff, data + info->cferom_offset,
+				       info->tail_offset - info->cferom_offset);
 
 	/* Tail */
 
-	if (fread(tail, 1, sizeof(*tail), fp) != sizeof(*tail)) {
-		fprintf(stderr, "Failed to read BCM4908 image tail\n");
-		return -EIO;
-	}
+	memcpy(tail, data + info->tail_offset, sizeof(*tail));
 
 	/* Standard validation */
 
@@ -444,6 +468,7 @@ static int bcm4908img_info(int argc, char **argv) {
 	printf("Checksum:\t0x%08x\n", info.crc32);
 
 err_close:
+	bcm4908img_unmap(&info);
 	bcm4908img_close(fp);
 out:
 	return err;
@@ -453,11 +478,12 @@ out:
  * Create
  **************************************************/
 
+static uint8_t bcm4908img_buf[BCM4908IMG_BUF_SIZE];
+
 static ssize_t bcm4908img_create_append_file(FILE *trx, const char *in_path, uint32_t *crc32) {
 	FILE *in;
 	size_t bytes;
 	ssize_t length = 0;
-	uint8_t buf[1024];
 
 	in = fopen(in_path, "r");
 	if (!in) {
@@ -465,13 +491,13 @@ static ssize_t bcm4908img_create_append_file(FILE *trx, const char *in_path, uin
 		return -EACCES;
 	}
 
-	while ((bytes = fread(buf, 1, sizeof(buf), in)) > 0) {
-		if (fwrite(buf, 1, bytes, trx) != bytes) {
+	while ((bytes = fread(bcm4908img_buf, 1, sizeof(bcm4908img_buf), in)) > 0) {
+		if (fwrite(bcm4908img_buf, 1, bytes, trx) != bytes) {
 			fprintf(stderr, "Failed to write %zu B to %s\n", bytes, pathname);
 			length = -EIO;
 			break;
 		}
-		*crc32 = bcm4908img_crc32(*crc32, buf, bytes);
+		*crc32 = bcm4908img_crc32(*crc32, bcm4908img_buf, bytes);
 		length += bytes;
 	}
 
@@ -480,29 +506,30 @@ static ssize_t bcm4908img_create_append_file(FILE *trx, const char *in_path, uin
 	return length;
 }
 
-static ssize_t bcm4908img_create_append_zeros(FILE *trx, size_t length) {
-	uint8_t *buf;
+static ssize_t bcm4908img_create_append_zeros(FILE *trx, size_t length, uint32_t *crc32) {
+	static const uint8_t zeros[BCM4908IMG_BUF_SIZE];
+	size_t left = length;
 
-	buf = malloc(length);
-	if (!buf)
-		return -ENOMEM;
-	memset(buf, 0, length);
+	while (left) {
+		size_t bytes = bcm4908img_min(sizeof(zeros), left);
 
-	if (fwrite(buf, 1, length, trx) != length) {
-		fprintf(stderr, "Failed to write %zu B to %s\n", length, pathname);
-		free(buf);
-		return -EIO;
+		if (fwrite(zeros, 1, bytes, trx) != bytes) {
+			fprintf(stderr, "Failed to write %zu B to %s\n", length, pathname);
+			return -EIO;
+		}
+		left -= bytes;
 	}
 
-	free(buf);
+	/* Padding is covered by the tail checksum like any other data */
+	*crc32 = bcm4908img_crc32_zeros(*crc32, length);
 
 	return length;
 }
 
-static ssize_t bcm4908img_create_align(FILE *trx, size_t cur_offset, size_t alignment) {
+static ssize_t bcm4908img_create_align(FILE *trx, size_t cur_offset, size_t alignment, uint32_t *crc32) {
 	if (cur_offset & (alignment - 1)) {
 		size_t length = alignment - (cur_offset % alignment);
-		return bcm4908img_create_append_zeros(trx, length);
+		return bcm4908img_create_append_zeros(trx, length, crc32);
 	}
 
 	return 0;
@@ -548,7 +575,7 @@ static int bcm4908img_create(int argc, char **argv) {
 			}
 			break;
 		case 'a':
-			bytes = bcm4908img_create_align(fp, cur_offset, strtol(optarg, NULL, 0));
+			bytes = bcm4908img_create_align(fp, cur_offset, strtol(optarg, NULL, 0), &crc32);
 			if (bytes < 0)
 				fprintf(stderr, "Failed to append zeros\n");
 			else
@@ -559,7 +586,7 @@ static int bcm4908img_create(int argc, char **argv) {
 			if (bytes < 0) {
 				fprintf(stderr, "Current BCM4908 image length is 0x%zx, can't pad it with zeros to 0x%lx\n", cur_offset, strtol(optarg, NULL, 0));
 			} else {
-				bytes = bcm4908img_create_append_zeros(fp, bytes);
+				bytes = bcm4908img_create_append_zeros(fp, bytes, &crc32);
 				if (bytes < 0)
 					fprintf(stderr, "Failed to append zeros\n");
 				else
@@ -593,10 +620,8 @@ static int bcm4908img_extract(int argc, char **argv) {
 	struct bcm4908img_info info;
 	const char *pathname = NULL;
 	const char *type = NULL;
-	uint8_t buf[1024];
 	size_t offset;
 	size_t length;
-	size_t bytes;
 	FILE *fp;
 	int c;
 	int err = 0;
@@ -658,18 +683,14 @@ static int bcm4908img_extract(int argc, char **argv) {
 		goto err_close;
 	}
 
-	fseek(fp, offset, SEEK_SET);
-	while (length && (bytes = fread(buf, 1, bcm4908img_min(sizeof(buf), length), fp)) > 0) {
-		fwrite(buf, bytes, 1, stdout);
-		length -= bytes;
-	}
-	if (length) {
+	if (fwrite(info.data + offset, 1, length, stdout) != length) {
 		err = -EIO;
-		fprintf(stderr, "Failed to read last %zd B of data\n", length);
+		fprintf(stderr, "Failed to write %zu B of data\n", length);
 		goto err_close;
 	}
 
 err_close:
+	bcm4908img_unmap(&info);
 	bcm4908img_close(fp);
 err_out:
 	return err;
@@ -741,57 +762,67 @@ struct jffs2_raw_dirent
 #define je16_to_cpu(x) ((x).v16)
 #define je32_to_cpu(x) ((x).v32)
 
-static int bcm4908img_bootfs_ls(FILE *fp, struct bcm4908img_info *info) {
+/*
+ * Copies dirent at the offset (and its name) out of the image mapping.
+ * Returns 1 for a dirent, 0 for other node types and -errno on errors.
+ */
+static int bcm4908img_bootfs_dirent(struct bcm4908img_info *info, size_t offset,
+				    struct jffs2_raw_dirent *dirent, char *name, size_t name_size) {
+	if (offset + sizeof(*dirent) > info->file_size) {
+		fprintf(stderr, "Failed to read %zu bytes\n", sizeof(*dirent));
+		return -EIO;
+	}
+	memcpy(dirent, info->data + offset, sizeof(*dirent));
+
+	if (je16_to_cpu(dirent->nodetype) != JFFS2_NODETYPE_DIRENT)
+		return 0;
+
+	if (dirent->nsize + 1 > name_size) {
+		fprintf(stderr, "Too long filename\n");
+		return -ENOMEM;
+	}
+
+	if (offset + sizeof(*dirent) + dirent->nsize > info->file_size) {
+		fprintf(stderr, "Failed to read filename\n");
+		return -EIO;
+	}
+	memcpy(name, info->data + offset + sizeof(*dirent), dirent->nsize);
+	name[dirent->nsize] = '\0';
+
+	return 1;
+}
+
+static int bcm4908img_bootfs_ls(struct bcm4908img_info *info) {
 	struct jffs2_unknown_node node;
 	struct jffs2_raw_dirent dirent;
 	size_t offset;
-	size_t bytes;
 	int err = 0;
+	int ret;
 
 	for (offset = info->bootfs_offset; ; offset += (je32_to_cpu(node.totlen) + 0x03) & ~0x03) {
 		char name[FILENAME_MAX + 1];
 
-		if (fseek(fp, offset, SEEK_SET)) {
-			err = -errno;
-			fprintf(stderr, "Failed to fseek: %d\n", err);
-			return err;
-		}
-
-		bytes = fread(&node, 1, sizeof(node), fp);
-		if (bytes != sizeof(node)) {
+		if (offset + sizeof(node) > info->file_size) {
 			fprintf(stderr, "Failed to read %zu bytes\n", sizeof(node));
 			return -EIO;
 		}
+		memcpy(&node, info->data + offset, sizeof(node));
 
 		if (je16_to_cpu(node.magic) != JFFS2_MAGIC_BITMASK) {
 			break;
 		}
 
-		if (je16_to_cpu(node.nodetype) != JFFS2_NODETYPE_DIRENT) {
-			continue;
-		}
-
-		memcpy(&dirent, &node, sizeof(node));
-		bytes += fread((uint8_t *)&dirent + sizeof(node), 1, sizeof(dirent) - sizeof(node), fp);
-		if (bytes != sizeof(dirent)) {
-			fprintf(stderr, "Failed to read %zu bytes\n", sizeof(node));
-			return -EIO;
-		}
-
-		if (dirent.nsize + 1 > sizeof(name)) {
+		ret = bcm4908img_bootfs_dirent(info, offset, &dirent, name, sizeof(name));
+		if (ret == -ENOMEM) {
 			/* Keep reading & printing BUT exit with error code */
-			fprintf(stderr, "Too long filename\n");
-			err = -ENOMEM;
+			err = ret;
+			continue;
+		} else if (ret < 0) {
+			return ret;
+		} else if (!ret) {
 			continue;
 		}
 
-		bytes = fread(name, 1, dirent.nsize, fp);
-		if (bytes != dirent.nsize) {
-			fprintf(stderr, "Failed to read filename\n");
-			return -EIO;
-		}
-		name[bytes] = '\0';
-
 		printf("%s\n", name);
 	}
 
@@ -804,8 +835,8 @@ static int bcm4908img_bootfs_mv(FILE *fp, struct bcm4908img_info *info, int argc
 	const char *oldname;
 	const char *newname;
 	size_t offset;
-	size_t bytes;
 	int err = -ENOENT;
+	int ret;
 
 	if (argc - optind < 2) {
 		fprintf(stderr, "No enough arguments passed\n");
@@ -820,48 +851,33 @@ static int bcm4908img_bootfs_mv(FILE *fp, struct bcm4908img_info *info, int argc
 	}
 
 	for (offset = info->bootfs_offset; ; offset += (je32_to_cpu(node.totlen) + 0x03) & ~0x03) {
+		uint8_t buf[sizeof(uint32_t) + UINT8_MAX];
 		char name[FILENAME_MAX];
+		size_t region;
+		size_t length;
 		uint32_t crc32;
+		size_t i;
 
-		if (fseek(fp, offset, SEEK_SET)) {
-			err = -errno;
-			fprintf(stderr, "Failed to fseek: %d\n", err);
-			return err;
-		}
-
-		bytes = fread(&node, 1, sizeof(node), fp);
-		if (bytes != sizeof(node)) {
+		if (offset + sizeof(node) > info->file_size) {
 			fprintf(stderr, "Failed to read %zu bytes\n", sizeof(node));
 			return -EIO;
 		}
+		memcpy(&node, info->data + offset, sizeof(node));
 
 		if (je16_to_cpu(node.magic) != JFFS2_MAGIC_BITMASK) {
 			break;
 		}
 
-		if (je16_to_cpu(node.nodetype) != JFFS2_NODETYPE_DIRENT) {
+		ret = bcm4908img_bootfs_dirent(info, offset, &dirent, name, sizeof(name));
+		if (ret == -ENOMEM) {
+			err = ret;
 			continue;
-		}
-
-		bytes += fread((uint8_t *)&dirent + sizeof(node), 1, sizeof(dirent) - sizeof(node), fp);
-		if (bytes != sizeof(dirent)) {
-			fprintf(stderr, "Failed to read %zu bytes\n", sizeof(node));
-			return -EIO;
-		}
-
-		if (dirent.nsize + 1 > sizeof(name)) {
-			fprintf(stderr, "Too long filename\n");
-			err = -ENOMEM;
+		} else if (ret < 0) {
+			return ret;
+		} else if (!ret) {
 			continue;
 		}
 
-		bytes = fread(name, 1, dirent.nsize, fp);
-		if (bytes != dirent.nsize) {
-			fprintf(stderr, "Failed to read filename\n");
-			return -EIO;
-		}
-		name[bytes] = '\0';
-
 		if (debug)
 			printf("offset:%08zx name_crc:%04x filename:%s\n", offset, je32_to_cpu(dirent.name_crc), name);
 
@@ -869,39 +885,45 @@ static int bcm4908img_bootfs_mv(FILE *fp, struct bcm4908img_info *info, int argc
 			continue;
 		}
 
-		if (fseek(fp, offset + offsetof(struct jffs2_raw_dirent, name_crc), SEEK_SET)) {
-			err = -errno;
-			fprintf(stderr, "Failed to fseek: %d\n", err);
-			return err;
+		/* name_crc is directly followed by the name so rewrite both at once */
+		region = offset + offsetof(struct jffs2_raw_dirent, name_crc);
+		length = sizeof(crc32) + dirent.nsize;
+		if (region + length > info->tail_offset) {
+			fprintf(stderr, "Dirent of %s is outside of the firmware\n", oldname);
+			return -EPROTO;
 		}
+
 		crc32 = bcm4908img_crc32(0, newname, dirent.nsize);
-		bytes = fwrite(&crc32, 1, sizeof(crc32), fp);
-		if (bytes != sizeof(crc32)) {
-			fprintf(stderr, "Failed to write new CRC32\n");
-			return -EIO;
+		memcpy(buf, &crc32, sizeof(crc32));
+		memcpy(buf + sizeof(crc32), newname, dirent.nsize);
+
+		/*
+		 * Calculate new BCM4908 image checksum. CRC32 is linear so it's
+		 * enough to checksum the difference between old and new bytes and
+		 * shift it over the data that follows them.
+		 */
+		{
+			uint8_t delta[sizeof(buf)];
+
+			for (i = 0; i < length; i++)
+				delta[i] = buf[i] ^ info->data[region + i];
+			crc32 = bcm4908img_crc32(0, delta, length);
+			crc32 = bcm4908img_crc32_zeros(crc32, info->tail_offset - region - length);
+			info->crc32 ^= crc32;
 		}
 
-		if (fseek(fp, offset + offsetof(struct jffs2_raw_dirent, name), SEEK_SET)) {
+		if (fseek(fp, region, SEEK_SET)) {
 			err = -errno;
 			fprintf(stderr, "Failed to fseek: %d\n", err);
 			return err;
 		}
-		bytes = fwrite(newname, 1, dirent.nsize, fp);
-		if (bytes != dirent.nsize) {
+		if (fwrite(buf, 1, length, fp) != length) {
 			fprintf(stderr, "Failed to write new filename\n");
 			return -EIO;
 		}
 
-		/* Calculate new BCM4908 image checksum */
-
-		err = bcm4908img_calc_crc32(fp, info);
-		if (err) {
-			fprintf(stderr, "Failed to write new filename\n");
-			return err;
-		}
-
 		info->tail.crc32 = cpu_to_le32(info->crc32);
-		if (fseek(fp, -sizeof(struct bcm4908img_tail), SEEK_END)) {
+		if (fseek(fp, info->tail_offset, SEEK_SET)) {
 			err = -errno;
 			fprintf(stderr, "Failed to write new filename\n");
 			return err;
@@ -961,7 +983,7 @@ static int bcm4908img_bootfs(int argc, char **argv) {
 	}
 
 	if (!strcmp(cmd, "ls")) {
-		err = bcm4908img_bootfs_ls(fp, &info);
+		err = bcm4908img_bootfs_ls(&info);
 	} else if (!strcmp(cmd, "mv")) {
 		err = bcm4908img_bootfs_mv(fp, &info, argc, argv);
 	} else {
@@ -970,6 +992,7 @@ static int bcm4908img_bootfs(int argc, char **argv) {
 	}
 
 err_close:
+	bcm4908img_unmap(&info);
 	bcm4908img_close(fp);
 out:
 	return err;
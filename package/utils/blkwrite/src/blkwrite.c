@@ -0,0 +1,453 @@
+/*
+ * blkwrite
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * Writes an image (stdin by default) to a block device in large aligned
+ * chunks. Chunks that already hold the same data can be skipped to save
+ * flash wear, the rest of the device can be discarded or zeroed and the
+ * written data is read back and verified against a per chunk CRC32.
+ *
+ * The number of image bytes is printed to stdout on success.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <linux/fs.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BLKWRITE_CHUNK_SIZE		(1024 * 1024)
+#define BLKWRITE_ALIGN			4096
+
+static const char *in_path;
+static const char *dev_path;
+static uint64_t dev_offset;
+static size_t chunk_size = BLKWRITE_CHUNK_SIZE;
+static bool direct;
+static bool skip_unchanged;
+static bool discard_rest;
+static uint64_t zero_length;
+static bool verify;
+static bool verbose;
+
+static uint32_t crc32_tbl[256];
+
+/* Accepts k, M and G suffixes */
+static uint64_t blkwrite_parse_size(const char *str) {
+	char *end;
+	uint64_t size = strtoull(str, &end, 0);
+
+	switch (*end) {
+	case 'G':
+		size <<= 10;
+		/* fall through */
+	case 'M':
+		size <<= 10;
+		/* fall through */
+	case 'k':
+		size <<= 10;
+	}
+
+	return size;
+}
+
+static inline uint64_t blkwrite_round_up(uint64_t x, uint64_t align) {
+	return (x + align - 1) / align * align;
+}
+
+/**************************************************
+ * CRC32
+ **************************************************/
+
+static void blkwrite_crc32_init(void) {
+	uint32_t c;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		c = i;
+		for (j = 0; j < 8; j++)
+			c = (c & 1) ? (c >> 1) ^ 0xedb88320 : c >> 1;
+		crc32_tbl[i] = c;
+	}
+}
+
+static uint32_t blkwrite_crc32(const void *buf, size_t len) {
+	const uint8_t *in = buf;
+	uint32_t crc = 0xffffffff;
+
+	while (len--)
+		crc = crc32_tbl[(crc ^ *in++) & 0xff] ^ (crc >> 8);
+
+	return crc ^ 0xffffffff;
+}
+
+/**************************************************
+ * I/O helpers
+ **************************************************/
+
+/* Fills buf completely unless EOF is reached */
+static ssize_t blkwrite_read_full(int fd, uint8_t *buf, size_t len) {
+	size_t done = 0;
+	ssize_t bytes;
+
+	while (done < len) {
+		bytes = read(fd, buf + done, len - done);
+		if (bytes < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		if (!bytes)
+			break;
+		done += bytes;
+	}
+
+	return done;
+}
+
+static int blkwrite_pread_full(int fd, uint8_t *buf, size_t len, uint64_t offset) {
+	size_t done = 0;
+	ssize_t bytes;
+
+	while (done < len) {
+		bytes = pread(fd, buf + done, len - done, offset + done);
+		if (bytes < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		if (!bytes)
+			return -EIO;
+		done += bytes;
+	}
+
+	return 0;
+}
+
+static int blkwrite_pwrite_full(int fd, const uint8_t *buf, size_t len, uint64_t offset) {
+	size_t done = 0;
+	ssize_t bytes;
+
+	while (done < len) {
+		bytes = pwrite(fd, buf + done, len - done, offset + done);
+		if (bytes < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		done += bytes;
+	}
+
+	return 0;
+}
+
+static int blkwrite_dev_geometry(int fd, uint64_t *size, unsigned int *block_size) {
+	struct stat st;
+	int ssz;
+
+	if (fstat(fd, &st))
+		return -errno;
+
+	if (!S_ISBLK(st.st_mode)) {
+		*size = st.st_size;
+		*block_size = 512;
+		return 0;
+	}
+
+	if (ioctl(fd, BLKGETSIZE64, size))
+		return -errno;
+
+	if (ioctl(fd, BLKSSZGET, &ssz) || ssz <= 0)
+		ssz = 512;
+	*block_size = ssz;
+
+	return 0;
+}
+
+/* Range has to be block aligned */
+static int blkwrite_clear(int fd, uint64_t start, uint64_t len, bool zero) {
+	uint64_t range[2] = { start, len };
+
+	if (!len)
+		return 0;
+
+	if (!ioctl(fd, zero ? BLKZEROOUT : BLKDISCARD, range))
+		return 0;
+
+	/* Not a block device (e.g. an image file): punch a hole instead */
+	if (errno == ENOTTY &&
+	    !fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, start, len))
+		return 0;
+
+	return -errno;
+}
+
+/**************************************************
+ * Write
+ **************************************************/
+
+static int blkwrite_verify(int fd, uint8_t *buf, const uint32_t *crcs, size_t n_chunks,
+			   uint64_t length, unsigned int block_size) {
+	uint64_t offset = 0;
+	size_t i;
+	int err;
+
+	/* Make sure data comes from the device rather than the page cache */
+	if (!direct)
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+
+	for (i = 0; i < n_chunks; i++, offset += chunk_size) {
+		size_t len = length - offset < chunk_size ? length - offset : chunk_size;
+
+		err = blkwrite_pread_full(fd, buf, blkwrite_round_up(len, block_size), dev_offset + offset);
+		if (err) {
+			fprintf(stderr, "Failed to read back 0x%" PRIx64 ": %d\n", dev_offset + offset, err);
+			return err;
+		}
+
+		if (blkwrite_crc32(buf, len) != crcs[i]) {
+			fprintf(stderr, "Verification failed at 0x%" PRIx64 "\n", dev_offset + offset);
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+static int blkwrite_write(void) {
+	uint64_t length = 0, written = 0, dev_size;
+	uint32_t *crcs = NULL;
+	size_t n_chunks = 0;
+	unsigned int block_size = 512;
+	uint8_t *data = NULL;
+	uint8_t *old = NULL;
+	int in = STDIN_FILENO;
+	int fd;
+	int err;
+
+	if (in_path) {
+		in = open(in_path, O_RDONLY);
+		if (in < 0) {
+			fprintf(stderr, "Failed to open %s\n", in_path);
+			return -EACCES;
+		}
+	} else {
+		/* Let the producer (e.g. tar) work ahead while we wait for the device */
+		fcntl(in, F_SETPIPE_SZ, chunk_size);
+	}
+
+	fd = open(dev_path, O_RDWR | (direct ? O_DIRECT : 0));
+	if (fd < 0) {
+		err = -errno;
+		fprintf(stderr, "Failed to open %s: %d\n", dev_path, err);
+		goto err_close_in;
+	}
+
+	err = blkwrite_dev_geometry(fd, &dev_size, &block_size);
+	if (err) {
+		fprintf(stderr, "Failed to get %s size: %d\n", dev_path, err);
+		goto err_close;
+	}
+
+	if (dev_offset % block_size || chunk_size % block_size) {
+		fprintf(stderr, "Offset and chunk size have to be multiples of %u\n", block_size);
+		err = -EINVAL;
+		goto err_close;
+	}
+
+	if (posix_memalign((void **)&data, BLKWRITE_ALIGN, chunk_size) ||
+	    posix_memalign((void **)&old, BLKWRITE_ALIGN, chunk_size)) {
+		err = -ENOMEM;
+		goto err_free;
+	}
+
+	while (1) {
+		uint64_t offset = dev_offset + length;
+		ssize_t len;
+		size_t wlen;
+
+		len = blkwrite_read_full(in, data, chunk_size);
+		if (len < 0) {
+			err = len;
+			fprintf(stderr, "Failed to read input: %d\n", err);
+			goto err_free;
+		}
+		if (!len)
+			break;
+
+		wlen = blkwrite_round_up(len, block_size);
+		if (offset + wlen > dev_size) {
+			fprintf(stderr, "Image doesn't fit %s (0x%" PRIx64 " B)\n", dev_path, dev_size);
+			err = -ENOSPC;
+			goto err_free;
+		}
+
+		/*
+		 * Partial blocks keep the rest of their current content unless
+		 * whatever follows the image is going to be cleared anyway
+		 */
+		if (skip_unchanged || wlen != len) {
+			err = blkwrite_pread_full(fd, old, wlen, offset);
+			if (err) {
+				fprintf(stderr, "Failed to read 0x%" PRIx64 ": %d\n", offset, err);
+				goto err_free;
+			}
+			if (zero_length || discard_rest)
+				memset(data + len, 0, wlen - len);
+			else
+				memcpy(data + len, old + len, wlen - len);
+		}
+
+		if (!skip_unchanged || memcmp(data, old, wlen)) {
+			err = blkwrite_pwrite_full(fd, data, wlen, offset);
+			if (err) {
+				fprintf(stderr, "Failed to write 0x%" PRIx64 ": %d\n", offset, err);
+				goto err_free;
+			}
+			written += len;
+		}
+
+		if (verify) {
+			uint32_t *tmp = realloc(crcs, (n_chunks + 1) * sizeof(*crcs));
+
+			if (!tmp) {
+				err = -ENOMEM;
+				goto err_free;
+			}
+			crcs = tmp;
+			crcs[n_chunks++] = blkwrite_crc32(data, len);
+		}
+
+		length += len;
+		if (len < chunk_size)
+			break;
+	}
+
+	if (discard_rest || zero_length) {
+		uint64_t start = blkwrite_round_up(dev_offset + length, block_size);
+		uint64_t zero_end = blkwrite_round_up(start + zero_length, block_size);
+
+		if (zero_end > dev_size)
+			zero_end = dev_size;
+
+		err = blkwrite_clear(fd, start, zero_end - start, true);
+		if (err) {
+			fprintf(stderr, "Failed to zero 0x%" PRIx64 " - 0x%" PRIx64 ": %d\n", start, zero_end, err);
+			goto err_free;
+		}
+
+		/* Discarding is only a hint to the device, ignore failures */
+		if (discard_rest && blkwrite_clear(fd, zero_end, dev_size - zero_end, false) && verbose)
+			fprintf(stderr, "Failed to discard 0x%" PRIx64 " - 0x%" PRIx64 "\n", zero_end, dev_size);
+	}
+
+	if (fsync(fd)) {
+		err = -errno;
+		fprintf(stderr, "Failed to sync %s: %d\n", dev_path, err);
+		goto err_free;
+	}
+
+	if (verify) {
+		err = blkwrite_verify(fd, data, crcs, n_chunks, length, block_size);
+		if (err)
+			goto err_free;
+	}
+
+	if (verbose)
+		fprintf(stderr, "%s: %" PRIu64 " B, %" PRIu64 " B written, %" PRIu64 " B unchanged\n",
+			dev_path, length, written, length - written);
+	printf("%" PRIu64 "\n", length);
+
+err_free:
+	free(crcs);
+	free(old);
+	free(data);
+err_close:
+	close(fd);
+err_close_in:
+	if (in != STDIN_FILENO)
+		close(in);
+	return err;
+}
+
+/**************************************************
+ * Start
+ **************************************************/
+
+static void usage() {
+	printf("Usage:\n");
+	printf("\n");
+	printf("Write image to a block device:\n");
+	printf("\tblkwrite [options] <device>\n");
+	printf("\t-i file\t\t\t\tinput image (default: stdin)\n");
+	printf("\t-o offset\t\t\tstart offset in the device (bytes)\n");
+	printf("\t-b size\t\t\t\tchunk size (default: 1 MiB)\n");
+	printf("\t-D\t\t\t\tuse O_DIRECT\n");
+	printf("\t-s\t\t\t\tskip chunks that already hold the same data\n");
+	printf("\t-z size\t\t\t\tzero size bytes following the image\n");
+	printf("\t-d\t\t\t\tdiscard the rest of the device\n");
+	printf("\t-V\t\t\t\tverify written data\n");
+	printf("\t-v\t\t\t\tverbose\n");
+}
+
+int main(int argc, char **argv) {
+	int c;
+
+	while ((c = getopt(argc, argv, "i:o:b:Dsz:dVv")) != -1) {
+		switch (c) {
+		case 'i':
+			in_path = optarg;
+			break;
+		case 'o':
+			dev_offset = blkwrite_parse_size(optarg);
+			break;
+		case 'b':
+			chunk_size = blkwrite_parse_size(optarg);
+			break;
+		case 'D':
+			direct = true;
+			break;
+		case 's':
+			skip_unchanged = true;
+			break;
+		case 'z':
+			zero_length = blkwrite_parse_size(optarg);
+			break;
+		case 'd':
+			discard_rest = true;
+			break;
+		case 'V':
+			verify = true;
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	if (optind >= argc || !chunk_size) {
+		usage();
+		return 1;
+	}
+	dev_path = argv[optind];
+
+	blkwrite_crc32_init();
+
+	return blkwrite_write() ? 1 : 0;
+}
@@ -0,0 +1,369 @@
+/*
+ * confscan
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * Finds configuration files that have to go into a sysupgrade backup
+ * without forking a test/cmp/sha256sum process per file:
+ *
+ *  -u: reads a list of paths from stdin and prints those that do not
+ *      exist in /rom or whose content differs from the /rom copy
+ *  -c: prints opkg conffiles whose SHA-256 does not match the checksum
+ *      recorded in the opkg status file
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CONFSCAN_BUF_SIZE		(64 * 1024)
+
+static const char *rom_dir = "/rom";
+static const char *status_path = "/usr/lib/opkg/status";
+
+static uint8_t buf_a[CONFSCAN_BUF_SIZE];
+static uint8_t buf_b[CONFSCAN_BUF_SIZE];
+
+/**************************************************
+ * SHA-256
+ **************************************************/
+
+struct sha256_ctx {
+	uint32_t state[8];
+	uint64_t len;
+	uint8_t buf[64];
+	size_t buf_len;
+};
+
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR32(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_init(struct sha256_ctx *ctx) {
+	static const uint32_t init[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+	};
+
+	memcpy(ctx->state, init, sizeof(init));
+	ctx->len = 0;
+	ctx->buf_len = 0;
+}
+
+static void sha256_block(struct sha256_ctx *ctx, const uint8_t *p) {
+	uint32_t w[64], s[8], t1, t2;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = (uint32_t)p[i * 4] << 24 | p[i * 4 + 1] << 16 |
+		       p[i * 4 + 2] << 8 | p[i * 4 + 3];
+	for (; i < 64; i++)
+		w[i] = w[i - 16] + w[i - 7] +
+		       (ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18) ^ (w[i - 15] >> 3)) +
+		       (ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19) ^ (w[i - 2] >> 10));
+
+	memcpy(s, ctx->state, sizeof(s));
+	for (i = 0; i < 64; i++) {
+		t1 = s[7] + (ROR32(s[4], 6) ^ ROR32(s[4], 11) ^ ROR32(s[4], 25)) +
+		     ((s[4] & s[5]) ^ (~s[4] & s[6])) + sha256_k[i] + w[i];
+		t2 = (ROR32(s[0], 2) ^ ROR32(s[0], 13) ^ ROR32(s[0], 22)) +
+		     ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+		memmove(&s[1], &s[0], 7 * sizeof(s[0]));
+		s[4] += t1;
+		s[0] = t1 + t2;
+	}
+
+	for (i = 0; i < 8; i++)
+		ctx->state[i] += s[i];
+}
+
+static void sha256_update(struct sha256_ctx *ctx, const uint8_t *data, size_t len) {
+	size_t n;
+
+	ctx->len += len;
+
+	if (ctx->buf_len) {
+		n = 64 - ctx->buf_len;
+		if (n > len)
+			n = len;
+		memcpy(ctx->buf + ctx->buf_len, data, n);
+		ctx->buf_len += n;
+		data += n;
+		len -= n;
+		if (ctx->buf_len < 64)
+			return;
+		sha256_block(ctx, ctx->buf);
+		ctx->buf_len = 0;
+	}
+
+	for (; len >= 64; data += 64, len -= 64)
+		sha256_block(ctx, data);
+
+	memcpy(ctx->buf, data, len);
+	ctx->buf_len = len;
+}
+
+static void sha256_final(struct sha256_ctx *ctx, uint8_t *digest) {
+	uint64_t bits = ctx->len * 8;
+	int i;
+
+	ctx->buf[ctx->buf_len++] = 0x80;
+	if (ctx->buf_len > 56) {
+		memset(ctx->buf + ctx->buf_len, 0, 64 - ctx->buf_len);
+		sha256_block(ctx, ctx->buf);
+		ctx->buf_len = 0;
+	}
+	memset(ctx->buf + ctx->buf_len, 0, 56 - ctx->buf_len);
+	for (i = 0; i < 8; i++)
+		ctx->buf[56 + i] = bits >> (56 - i * 8);
+	sha256_block(ctx, ctx->buf);
+
+	for (i = 0; i < 32; i++)
+		digest[i] = ctx->state[i / 4] >> (24 - (i % 4) * 8);
+}
+
+/**************************************************
+ * Helpers
+ **************************************************/
+
+/* Fills buf completely unless EOF is reached */
+static ssize_t confscan_read_full(int fd, uint8_t *buf, size_t len) {
+	size_t done = 0;
+	ssize_t bytes;
+
+	while (done < len) {
+		bytes = read(fd, buf + done, len - done);
+		if (bytes < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		if (!bytes)
+			break;
+		done += bytes;
+	}
+
+	return done;
+}
+
+static void confscan_chomp(char *line) {
+	size_t len = strlen(line);
+
+	while (len && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+		line[--len] = '\0';
+}
+
+/**************************************************
+ * Unchanged file filter
+ **************************************************/
+
+/* Same semantics as "test -e /rom/$path && cmp -s /$path /rom/$path" */
+static bool confscan_same_as_rom(const char *path) {
+	char live[PATH_MAX], rom[PATH_MAX];
+	struct stat st_live, st_rom;
+	ssize_t len_a, len_b;
+	bool same = false;
+	int fd_a, fd_b;
+
+	if (snprintf(live, sizeof(live), "%s%s", *path == '/' ? "" : "/", path) >= (int)sizeof(live) ||
+	    snprintf(rom, sizeof(rom), "%s/%s", rom_dir, path) >= (int)sizeof(rom))
+		return false;
+
+	if (stat(rom, &st_rom) || stat(live, &st_live))
+		return false;
+
+	/* The cheap checks: both must be regular files of the same size */
+	if (!S_ISREG(st_rom.st_mode) || !S_ISREG(st_live.st_mode) ||
+	    st_rom.st_size != st_live.st_size)
+		return false;
+
+	if (st_rom.st_dev == st_live.st_dev && st_rom.st_ino == st_live.st_ino)
+		return true;
+
+	fd_a = open(live, O_RDONLY);
+	if (fd_a < 0)
+		return false;
+	fd_b = open(rom, O_RDONLY);
+	if (fd_b < 0) {
+		close(fd_a);
+		return false;
+	}
+
+	while (1) {
+		len_a = confscan_read_full(fd_a, buf_a, sizeof(buf_a));
+		len_b = confscan_read_full(fd_b, buf_b, sizeof(buf_b));
+		if (len_a < 0 || len_a != len_b || memcmp(buf_a, buf_b, len_a))
+			break;
+		if (!len_a) {
+			same = true;
+			break;
+		}
+	}
+
+	close(fd_b);
+	close(fd_a);
+
+	return same;
+}
+
+static int confscan_unchanged(void) {
+	char path[PATH_MAX];
+
+	while (fgets(path, sizeof(path), stdin)) {
+		confscan_chomp(path);
+		if (!*path)
+			continue;
+		if (!confscan_same_as_rom(path))
+			printf("%s\n", path);
+	}
+
+	return 0;
+}
+
+/**************************************************
+ * Changed opkg conffiles
+ **************************************************/
+
+static bool confscan_csum_matches(const char *path, const char *csum) {
+	static const char hex[] = "0123456789abcdef";
+	struct sha256_ctx ctx;
+	uint8_t digest[32];
+	char str[65];
+	ssize_t len;
+	int fd, i;
+
+	/* Anything but a SHA-256 can never match, as with sha256sum -c */
+	if (strlen(csum) != 64)
+		return false;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	sha256_init(&ctx);
+	while ((len = confscan_read_full(fd, buf_a, sizeof(buf_a))) > 0)
+		sha256_update(&ctx, buf_a, len);
+	close(fd);
+	if (len < 0)
+		return false;
+	sha256_final(&ctx, digest);
+
+	for (i = 0; i < 32; i++) {
+		str[i * 2] = hex[digest[i] >> 4];
+		str[i * 2 + 1] = hex[digest[i] & 0xf];
+	}
+	str[64] = '\0';
+
+	return !strcmp(str, csum);
+}
+
+static int confscan_conffiles(void) {
+	char line[PATH_MAX + 128];
+	bool conffiles = false;
+	char *file, *csum;
+	FILE *f;
+
+	f = fopen(status_path, "r");
+	if (!f) {
+		fprintf(stderr, "Couldn't open %s\n", status_path);
+		return -errno;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		confscan_chomp(line);
+
+		if (!strncmp(line, "Conffiles:", 10)) {
+			conffiles = true;
+			continue;
+		}
+		if (*line != ' ') {
+			conffiles = false;
+			continue;
+		}
+		if (!conffiles)
+			continue;
+
+		/* Cannot handle spaces in filenames - but opkg cannot either... */
+		file = strtok(line, " ");
+		csum = strtok(NULL, " ");
+		if (!file || access(file, R_OK))
+			continue;
+
+		if (!csum || !confscan_csum_matches(file, csum))
+			printf("%s\n", file);
+	}
+
+	fclose(f);
+
+	return 0;
+}
+
+/**************************************************
+ * Start
+ **************************************************/
+
+static void usage() {
+	printf("Usage:\n");
+	printf("\n");
+	printf("Print paths from stdin that differ from their /rom copy:\n");
+	printf("\tconfscan -u [options]\n");
+	printf("\t-r <dir>\t\t\tread-only root (default: /rom)\n");
+	printf("\n");
+	printf("Print opkg conffiles that differ from their recorded checksum:\n");
+	printf("\tconfscan -c [options]\n");
+	printf("\t-s <file>\t\t\topkg status file (default: /usr/lib/opkg/status)\n");
+}
+
+int main(int argc, char **argv) {
+	bool unchanged = false, conffiles = false;
+	int c;
+
+	while ((c = getopt(argc, argv, "ucr:s:")) != -1) {
+		switch (c) {
+		case 'u':
+			unchanged = true;
+			break;
+		case 'c':
+			conffiles = true;
+			break;
+		case 'r':
+			rom_dir = optarg;
+			break;
+		case 's':
+			status_path = optarg;
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	if (unchanged == conffiles) {
+		usage();
+		return 1;
+	}
+
+	if (unchanged)
+		return confscan_unchanged() ? 1 : 0;
+
+	return confscan_conffiles() ? 1 : 0;
+}
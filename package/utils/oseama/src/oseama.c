@@ -40,6 +40,8 @@
 
 #define SEAMA_MAGIC			0x5ea3a417
 
+#define OSEAMA_BUF_SIZE			(64 * 1024)
+
 struct seama_seal_header {
 	uint32_t magic;
 	uint16_t reserved;
@@ -59,6 +61,9 @@ char *seama_path;
 int entity_idx = -1;
 char *out_path;
 
+static uint8_t copy_buf[OSEAMA_BUF_SIZE];
+static const uint8_t zero_buf[OSEAMA_BUF_SIZE];
+
 static inline size_t oseama_min(size_t x, size_t y) {
 	return x < y ? x : y;
 }
@@ -221,11 +226,10 @@ out:
  * Create
  **************************************************/
 
-static ssize_t oseama_entity_append_file(FILE *seama, const char *in_path) {
+static ssize_t oseama_entity_append_file(FILE *seama, const char *in_path, MD5_CTX *ctx) {
 	FILE *in;
 	size_t bytes;
 	ssize_t length = 0;
-	uint8_t buf[128];
 
 	in = fopen(in_path, "r");
 	if (!in) {
@@ -233,12 +237,14 @@ static ssize_t oseama_entity_append_file(FILE *seama, const char *in_path) {
 		return -EACCES;
 	}
 
-	while ((bytes = fread(buf, 1, sizeof(buf), in)) > 0) {
-		if (fwrite(buf, 1, bytes, seama) != bytes) {
+	/* Hash while copying so the image doesn't have to be read back */
+	while ((bytes = fread(copy_buf, 1, sizeof(copy_buf), in)) > 0) {
+		if (fwrite(copy_buf, 1, bytes, seama) != bytes) {
 			fprintf(stderr, "Couldn't write %zu B to %s\n", bytes, seama_path);
 			length = -EIO;
 			break;
 		}
+		MD5_Update(ctx, copy_buf, bytes);
 		length += bytes;
 	}
 
@@ -247,19 +253,20 @@ static ssize_t oseama_entity_append_file(FILE *seama, const char *in_path) {
 	return length;
 }
 
-static ssize_t oseama_entity_append_zeros(FILE *seama, size_t length) {
-	uint8_t *buf;
-
-	buf = malloc(length);
-	if (!buf)
-		return -ENOMEM;
-	memset(buf, 0, length);
+static ssize_t oseama_entity_append_zeros(FILE *seama, size_t length, MD5_CTX *ctx) {
+	size_t bytes;
 
-	if (fwrite(buf, 1, length, seama) != length) {
-		fprintf(stderr, "Couldn't write %zu B to %s\n", length, seama_path);
+	/* Zeros are left as a hole, the file size is fixed up at the end */
+	if (fseek(seama, length, SEEK_CUR)) {
+		fprintf(stderr, "Couldn't seek %zu B in %s\n", length, seama_path);
 		return -EIO;
 	}
 
+	if (ctx) {
+		for (bytes = length; bytes; bytes -= oseama_min(sizeof(zero_buf), bytes))
+			MD5_Update(ctx, zero_buf, oseama_min(sizeof(zero_buf), bytes));
+	}
+
 	return length;
 }
 
@@ -267,26 +274,17 @@ static ssize_t oseama_entity_align(FILE *seama, size_t curr_offset, size_t align
 	if (curr_offset & (alignment - 1)) {
 		size_t length = alignment - (curr_offset % alignment);
 
-		return oseama_entity_append_zeros(seama, length);
+		return oseama_entity_append_zeros(seama, length, NULL);
 	}
 
 	return 0;
 }
 
-static int oseama_entity_write_hdr(FILE *seama, size_t metasize, size_t imagesize) {
+static int oseama_entity_write_hdr(FILE *seama, size_t metasize, size_t imagesize, MD5_CTX *ctx) {
 	struct seama_entity_header hdr = {};
-	uint8_t buf[128];
-	size_t length = imagesize;
 	size_t bytes;
-	MD5_CTX ctx;
 
-	fseek(seama, sizeof(hdr) + metasize, SEEK_SET);
-	MD5_Init(&ctx);
-	while ((bytes = fread(buf, 1, oseama_min(sizeof(buf), length), seama)) > 0) {
-		MD5_Update(&ctx, buf, bytes);
-		length -= bytes;
-	}
-	MD5_Final(hdr.md5, &ctx);
+	MD5_Final(hdr.md5, ctx);
 
 	hdr.magic = cpu_to_be32(SEAMA_MAGIC);
 	hdr.metasize = cpu_to_be16(metasize);
@@ -307,6 +305,7 @@ static int oseama_entity(int argc, char **argv) {
 	ssize_t sbytes;
 	size_t curr_offset = sizeof(struct seama_entity_header);
 	size_t metasize = 0, imagesize = 0;
+	MD5_CTX ctx;
 	int c;
 	int err = 0;
 
@@ -324,6 +323,7 @@ static int oseama_entity(int argc, char **argv) {
 		goto out;
 	}
 	fseek(seama, curr_offset, SEEK_SET);
+	MD5_Init(&ctx);
 
 	optind = 3;
 	while ((c = getopt(argc, argv, "m:f:b:")) != -1) {
@@ -358,7 +358,7 @@ static int oseama_entity(int argc, char **argv) {
 		case 'm':
 			break;
 		case 'f':
-			sbytes = oseama_entity_append_file(seama, optarg);
+			sbytes = oseama_entity_append_file(seama, optarg, &ctx);
 			if (sbytes < 0) {
 				fprintf(stderr, "Failed to append file %s\n", optarg);
 			} else {
@@ -371,7 +371,7 @@ static int oseama_entity(int argc, char **argv) {
 			if (sbytes < 0) {
 				fprintf(stderr, "Current Seama entity length is 0x%zx, can't pad it with zeros to 0x%lx\n", curr_offset, strtol(optarg, NULL, 0));
 			} else {
-				sbytes = oseama_entity_append_zeros(seama, sbytes);
+				sbytes = oseama_entity_append_zeros(seama, sbytes, &ctx);
 				if (sbytes < 0) {
 					fprintf(stderr, "Failed to append zeros\n");
 				} else {
@@ -385,7 +385,14 @@ static int oseama_entity(int argc, char **argv) {
 			break;
 	}
 
-	oseama_entity_write_hdr(seama, metasize, imagesize);
+	/* Trailing zeros were skipped over, extend the file to cover them */
+	fflush(seama);
+	if (ftruncate(fileno(seama), curr_offset)) {
+		fprintf(stderr, "Couldn't extend %s to %zu B\n", seama_path, curr_offset);
+		err = -EIO;
+	}
+
+	oseama_entity_write_hdr(seama, metasize, imagesize, &ctx);
 
 	fclose(seama);
 out:
@@ -414,7 +421,6 @@ static void oseama_extract_parse_options(int argc, char **argv) {
 static int oseama_extract_entity(FILE *seama, FILE *out) {
 	struct seama_entity_header hdr;
 	size_t bytes, metasize, imagesize, length;
-	uint8_t buf[1024];
 	int i = 0;
 	int err = 0;
 
@@ -436,8 +442,8 @@ static int oseama_extract_entity(FILE *seama, FILE *out) {
 		fseek(seama, -sizeof(hdr), SEEK_CUR);
 
 		length = sizeof(hdr) + metasize + imagesize;
-		while ((bytes = fread(buf, 1, oseama_min(sizeof(buf), length), seama)) > 0) {
-			if (fwrite(buf, 1, bytes, out) != bytes) {
+		while ((bytes = fread(copy_buf, 1, oseama_min(sizeof(copy_buf), length), seama)) > 0) {
+			if (fwrite(copy_buf, 1, bytes, out) != bytes) {
 				fprintf(stderr, "Couldn't write %zu B to %s\n", bytes, out_path);
 				err = -EIO;
 				break;
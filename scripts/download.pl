@@ -11,7 +11,10 @@ use strict;
 use warnings;
 use File::Basename;
 use File::Copy;
+use File::Path;
+use Fcntl ':mode';
 use Text::ParseWords;
+use Time::HiRes;
 
 @ARGV > 2 or die "Syntax: $0 <target dir> <filename> <hash> <url filename> [<mirror> ...]\n";
 
@@ -96,6 +99,133 @@ sub download_cmd($) {
 my $hash_cmd = hash_cmd();
 $hash_cmd or ($file_hash eq "skip") or die "Cannot find appropriate hash command, ensure the provided hash is either a MD5 or SHA256 checksum.\n";
 
+# Local mirrors are indexed once in $TOPDIR/tmp/mirror-index instead of
+# running find for every file. The index lists the mtime of every
+# directory it has seen and is rebuilt as soon as one of them changed.
+# Verified hashes are appended to a second file and stay valid as long as
+# size and mtime of the mirrored file do.
+sub mirror_index_path($) {
+	my $mirror = shift;
+
+	$ENV{'TOPDIR'} or return undef;
+	(my $name = $mirror) =~ s![^\w.-]!_!g;
+
+	return "$ENV{'TOPDIR'}/tmp/mirror-index/$name";
+}
+
+sub mirror_index_scan($) {
+	my $mirror = shift;
+	my @todo = ($mirror);
+	my (@dirs, @files, %seen);
+
+	while (defined(my $dir = shift @todo)) {
+		my @st = Time::HiRes::stat($dir) or next;
+		# -follow semantics, but do not loop on symlinks to parents
+		$seen{"$st[0]:$st[1]"}++ and next;
+		push @dirs, "D $st[9] $dir\n";
+
+		opendir DIR, $dir or next;
+		my @entries = grep { $_ ne "." && $_ ne ".." } readdir DIR;
+		closedir DIR;
+
+		foreach my $entry (@entries) {
+			my $path = "$dir/$entry";
+			my @fst = stat($path) or next;
+
+			S_ISDIR($fst[2]) and push @todo, $path;
+			S_ISREG($fst[2]) and push @files, "F $path\n";
+		}
+	}
+
+	return join("", @dirs, @files);
+}
+
+sub mirror_index_valid($) {
+	my $index = shift;
+	my $dirs = 0;
+
+	while ($index =~ /^D (\S+) (.+)$/mg) {
+		my @st = Time::HiRes::stat($2);
+		@st and $st[9] eq $1 or return 0;
+		$dirs++;
+	}
+
+	return $dirs;
+}
+
+sub mirror_index($) {
+	my $mirror = shift;
+	my $path = mirror_index_path($mirror);
+	my $index;
+
+	$path and open INDEX, "<", $path and do {
+		local $/;
+		$index = <INDEX>;
+		close INDEX;
+	};
+	$index and mirror_index_valid($index) and return $index;
+
+	$index = mirror_index_scan($mirror);
+
+	$path and do {
+		mkpath(dirname($path));
+		open INDEX, ">", "$path.$$" and do {
+			print INDEX $index;
+			close INDEX;
+			rename("$path.$$", $path) or unlink("$path.$$");
+		};
+	};
+
+	return $index;
+}
+
+sub mirror_index_find($$) {
+	my $index = shift;
+	my $name = "/" . shift() . "\n";
+	my $pos = 0;
+	my @links;
+
+	while (($pos = index($index, $name, $pos)) >= 0) {
+		my $start = rindex($index, "\n", $pos) + 1;
+		my $line = substr($index, $start, $pos + length($name) - 1 - $start);
+
+		$line =~ s/^F // and push @links, $line;
+		$pos += length($name);
+	}
+
+	return @links;
+}
+
+sub mirror_hash_known($$) {
+	my $mirror = shift;
+	my $link = shift;
+	my $path = mirror_index_path($mirror);
+	my @st = Time::HiRes::stat($link);
+	my $known = 0;
+
+	$path and @st or return 0;
+	open HASHES, "<", "$path.hashes" or return 0;
+	while (<HASHES>) {
+		/^(\d+) (\S+) (\w+) (.+)$/ or next;
+		$4 eq $link and $1 == $st[7] and $2 eq $st[9] and $3 eq $file_hash and $known = 1;
+	}
+	close HASHES;
+
+	return $known;
+}
+
+sub mirror_hash_add($$) {
+	my $mirror = shift;
+	my $link = shift;
+	my $path = mirror_index_path($mirror);
+	my @st = Time::HiRes::stat($link);
+
+	$path and @st or return;
+	open HASHES, ">>", "$path.hashes" or return;
+	print HASHES "$st[7] $st[9] $file_hash $link\n";
+	close HASHES;
+}
+
 sub download
 {
 	my $mirror = shift;
@@ -114,36 +244,60 @@ sub download
 			system("mkdir", "-p", "$target/");
 		}
 
-		if (! open TMPDLS, "find $mirror -follow -name $filename 2>/dev/null |") {
-			print("Failed to search for $filename in $mirror\n");
-			return;
-		}
+		my $index = mirror_index($mirror);
+		my @links = mirror_index_find($index, $filename);
 
-		my $link;
-
-		while (defined(my $line = readline TMPDLS)) {
-			chomp ($link = $line);
-			if ($. > 1) {
-				print("$. or more instances of $filename in $mirror found . Only one instance allowed.\n");
-				return;
-			}
+		if (@links > 1) {
+			print(scalar(@links)." or more instances of $filename in $mirror found . Only one instance allowed.\n");
+			return;
 		}
 
-		close TMPDLS;
+		my $link = $links[0];
 
 		if (! $link) {
 			print("No instances of $filename found in $mirror.\n");
 			return;
 		}
 
-		print("Copying $filename from $link\n");
-		copy($link, "$target/$filename.dl");
+		my $cached = $hash_cmd && mirror_hash_known($mirror, $link);
 
-		$hash_cmd and do {
-			if (system("cat '$target/$filename.dl' | $hash_cmd > '$target/$filename.hash'")) {
-				print("Failed to generate hash for $filename\n");
+		# A hard link needs neither a copy nor, for a known file, a hash
+		if (link($link, "$target/$filename.dl")) {
+			print("Linking $filename from $link\n");
+
+			$hash_cmd and do {
+				if ($cached) {
+					open HASH, ">", "$target/$filename.hash" and print HASH "$file_hash\n";
+					close HASH;
+				} elsif (system("cat '$target/$filename.dl' | $hash_cmd > '$target/$filename.hash'")) {
+					print("Failed to generate hash for $filename\n");
+					return;
+				}
+			};
+		} else {
+			print("Copying $filename from $link\n");
+
+			open INPUT, "<", $link or do {
+				print("Failed to open $link\n");
 				return;
+			};
+			$hash_cmd and do {
+				open MD5SUM, "| $hash_cmd > '$target/$filename.hash'" or die "Cannot launch $hash_cmd.\n";
+			};
+			open OUTPUT, "> $target/$filename.dl" or die "Cannot create file $target/$filename.dl: $!\n";
+			my $buffer;
+			while (read INPUT, $buffer, 1048576) {
+				$hash_cmd and print MD5SUM $buffer;
+				print OUTPUT $buffer;
 			}
+			$hash_cmd and close MD5SUM;
+			close INPUT;
+			close OUTPUT;
+		}
+
+		$hash_cmd and !$cached and do {
+			my $sum = `cat "$target/$filename.hash"`;
+			$sum =~ /^(\w+)\s*/ and $1 eq $file_hash and mirror_hash_add($mirror, $link);
 		};
 	} else {
 		my @cmd = download_cmd("$mirror/$download_filename");
@@ -2,7 +2,7 @@ package metadata;
 use base 'Exporter';
 use strict;
 use warnings;
-our @EXPORT = qw(%package %vpackage %srcpackage %category %overrides clear_packages parse_package_metadata parse_target_metadata get_multiline @ignore %usernames %groupnames);
+our @EXPORT = qw(%package %vpackage %srcpackage %category %overrides clear_packages parse_package_metadata parse_package_metadata_cached parse_target_metadata get_multiline @ignore %usernames %groupnames);
 
 our %package;
 our %vpackage;
@@ -315,4 +315,69 @@ sub parse_package_metadata($) {
 	return 1;
 }
 
+# Parsed package metadata is kept in <file>.cache and reused as long as
+# size, mtime and MD5 of <file> are unchanged, and neither this parser nor
+# the calling script has been modified. Hosts without Storable or
+# Digest::MD5 simply parse every time.
+sub package_metadata_cache_key($) {
+	my $file = shift;
+	my @st = stat($file) or return undef;
+	my $key;
+
+	eval { require Storable; require Digest::MD5; 1 } or return undef;
+
+	open my $fh, "<", $file or return undef;
+	binmode $fh;
+	my $md5 = Digest::MD5->new->addfile($fh)->hexdigest;
+	close $fh;
+
+	$key = "$st[7]:$st[9]:$md5";
+	foreach my $script (__FILE__, $0) {
+		my @sst = stat($script) or return undef;
+		$key .= ":$sst[7]:$sst[9]";
+	}
+
+	return $key;
+}
+
+sub parse_package_metadata_cached($) {
+	my $file = shift;
+	my $key = package_metadata_cache_key($file);
+	my %ignore = map { $_ => 1 } @ignore;
+	my $cache;
+
+	$key and $cache = eval { Storable::retrieve("$file.cache") };
+	if ($cache and $cache->{key} eq $key) {
+		%package = %{$cache->{package}};
+		%vpackage = %{$cache->{vpackage}};
+		%srcpackage = %{$cache->{srcpackage}};
+		%category = %{$cache->{category}};
+		%overrides = %{$cache->{overrides}};
+		%usernames = %{$cache->{usernames}};
+		%groupnames = %{$cache->{groupnames}};
+
+		# --ignore differs between callers, so it is not part of the cache
+		$_->{ignore} = $ignore{$_->{name}} foreach values %srcpackage;
+		return 1;
+	}
+
+	parse_package_metadata($file) or return 0;
+
+	$key and eval {
+		Storable::nstore({
+			key => $key,
+			package => \%package,
+			vpackage => \%vpackage,
+			srcpackage => \%srcpackage,
+			category => \%category,
+			overrides => \%overrides,
+			usernames => \%usernames,
+			groupnames => \%groupnames,
+		}, "$file.cache.$$");
+		rename("$file.cache.$$", "$file.cache") or unlink("$file.cache.$$");
+	};
+
+	return 1;
+}
+
 1;
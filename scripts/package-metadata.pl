@@ -97,31 +97,32 @@ sub gen_kconfig_overrides() {
 	}
 }
 
-my %dep_check;
-sub __find_package_dep($$) {
+# Sorting a menu asks for every pair of packages, so the set of packages
+# each one (indirectly) depends on is only collected once
+my %dep_reach;
+sub package_dep_reach($) {
 	my $pkg = shift;
-	my $name = shift;
-	my $deps = $pkg->{depends};
-
-	return 0 unless defined $deps;
-	foreach my $vpkg (@{$deps}) {
-		foreach my $dep (@{$vpackage{$vpkg}}) {
-			next if $dep_check{$dep->{name}};
-			$dep_check{$dep->{name}} = 1;
-			return 1 if $dep->{name} eq $name;
-			return 1 if (__find_package_dep($dep, $name) == 1);
+	my @todo = ($pkg);
+	my %reach;
+
+	$dep_reach{$pkg} and return $dep_reach{$pkg};
+	while (my $cur = shift @todo) {
+		foreach my $vpkg (@{$cur->{depends} || []}) {
+			foreach my $dep (@{$vpackage{$vpkg} || []}) {
+				$reach{$dep->{name}}++ and next;
+				push @todo, $dep;
+			}
 		}
 	}
-	return 0;
+
+	return $dep_reach{$pkg} = \%reach;
 }
 
-# wrapper to avoid infinite recursion
 sub find_package_dep($$) {
 	my $pkg = shift;
 	my $name = shift;
 
-	%dep_check = ();
-	return __find_package_dep($pkg, $name);
+	return package_dep_reach($pkg)->{$name} ? 1 : 0;
 }
 
 sub package_depends($$) {
@@ -345,7 +346,7 @@ sub print_package_overrides() {
 }
 
 sub gen_package_config() {
-	parse_package_metadata($ARGV[0]) or exit 1;
+	parse_package_metadata_cached($ARGV[0]) or exit 1;
 	print "menuconfig IMAGEOPT\n\tbool \"Image configuration\"\n\tdefault n\n";
 	print "source \"package/*/image-config.in\"\n";
 	if (scalar glob "package/feeds/*/*/image-config.in") {
@@ -391,7 +392,7 @@ sub get_conditional_dep($$) {
 sub gen_package_mk() {
 	my $line;
 
-	parse_package_metadata($ARGV[0]) or exit 1;
+	parse_package_metadata_cached($ARGV[0]) or exit 1;
 	foreach my $srcname (sort {uc($a) cmp uc($b)} keys %srcpackage) {
 		my $src = $srcpackage{$srcname};
 		my $variant_default;
@@ -515,7 +516,7 @@ sub gen_package_mk() {
 }
 
 sub gen_package_source() {
-	parse_package_metadata($ARGV[0]) or exit 1;
+	parse_package_metadata_cached($ARGV[0]) or exit 1;
 	foreach my $name (sort {uc($a) cmp uc($b)} keys %package) {
 		my $pkg = $package{$name};
 		if ($pkg->{name} && $pkg->{source}) {
@@ -526,7 +527,7 @@ sub gen_package_source() {
 }
 
 sub gen_package_auxiliary() {
-	parse_package_metadata($ARGV[0]) or exit 1;
+	parse_package_metadata_cached($ARGV[0]) or exit 1;
 	foreach my $name (sort {uc($a) cmp uc($b)} keys %package) {
 		my $pkg = $package{$name};
 		if ($pkg->{name} && $pkg->{repository}) {
@@ -549,7 +550,7 @@ sub gen_package_auxiliary() {
 
 sub gen_package_license($) {
 	my $level = shift;
-	parse_package_metadata($ARGV[0]) or exit 1;
+	parse_package_metadata_cached($ARGV[0]) or exit 1;
 	foreach my $name (sort {uc($a) cmp uc($b)} keys %package) {
 		my $pkg = $package{$name};
 		if ($pkg->{name}) {
@@ -576,7 +577,7 @@ sub gen_version_filtered_list() {
 }
 
 sub gen_usergroup_list() {
-	parse_package_metadata($ARGV[0]) or exit 1;
+	parse_package_metadata_cached($ARGV[0]) or exit 1;
 	for my $name (keys %usernames) {
 		print "user $name $usernames{$name}{id} $usernames{$name}{makefile}\n";
 	}
@@ -587,7 +588,7 @@ sub gen_usergroup_list() {
 
 sub gen_package_manifest_json() {
 	my $json;
-	parse_package_metadata($ARGV[0]) or exit 1;
+	parse_package_metadata_cached($ARGV[0]) or exit 1;
 	foreach my $name (sort {uc($a) cmp uc($b)} keys %package) {
 		my %depends;
 		my $pkg = $package{$name};
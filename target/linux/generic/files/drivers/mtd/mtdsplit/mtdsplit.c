@@ -14,8 +14,12 @@
 
 #include <linux/export.h>
 #include <linux/init.h>
+#include <linux/jiffies.h>
 #include <linux/kernel.h>
 #include <linux/magic.h>
+#include <linux/mutex.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/partitions.h>
 #include <linux/byteorder/generic.h>
@@ -24,6 +28,155 @@
 
 #define UBI_EC_MAGIC			0x55424923	/* UBI# */
 
+/*
+ * Pages read by the parsers while probing, so the same header page is not
+ * read and ECC corrected again by every parser trying its magic on it.
+ * Entries are only trusted for a short time, probing is done by then.
+ * The cache only serves the parsers run during boot, partitions parsed
+ * later (modular flash drivers, dynamic splits) read the flash directly.
+ */
+#define MTDSPLIT_CACHE_PAGES		4
+#define MTDSPLIT_CACHE_TTL		HZ
+#define MTDSPLIT_CACHE_MIN_PAGE		512
+#define MTDSPLIT_CACHE_MAX_PAGE		SZ_16K
+
+struct mtdsplit_cache_page {
+	struct mtd_info *mtd;
+	loff_t offset;
+	unsigned long stamp;
+	size_t size;
+	u_char *data;
+};
+
+static struct mtdsplit_cache_page mtdsplit_cache[MTDSPLIT_CACHE_PAGES];
+static unsigned int mtdsplit_cache_next;
+static bool mtdsplit_cache_disabled;
+static DEFINE_MUTEX(mtdsplit_cache_lock);
+
+static struct mtdsplit_cache_page *
+mtdsplit_cache_lookup(struct mtd_info *mtd, loff_t offset)
+{
+	struct mtdsplit_cache_page *page;
+	int i;
+
+	for (i = 0; i < MTDSPLIT_CACHE_PAGES; i++) {
+		page = &mtdsplit_cache[i];
+		if (page->mtd != mtd || page->offset != offset ||
+		    page->size != mtd->writesize)
+			continue;
+
+		if (time_after(jiffies, page->stamp + MTDSPLIT_CACHE_TTL)) {
+			page->mtd = NULL;
+			continue;
+		}
+
+		return page;
+	}
+
+	return NULL;
+}
+
+static struct mtdsplit_cache_page *
+mtdsplit_cache_fill(struct mtd_info *mtd, loff_t offset, int *err)
+{
+	struct mtdsplit_cache_page *page;
+	size_t retlen;
+	int ret;
+
+	page = &mtdsplit_cache[mtdsplit_cache_next];
+
+	if (page->size != mtd->writesize) {
+		kfree(page->data);
+		page->mtd = NULL;
+		page->size = 0;
+		page->data = kmalloc(mtd->writesize, GFP_KERNEL);
+		if (!page->data) {
+			*err = -ENOMEM;
+			return NULL;
+		}
+		page->size = mtd->writesize;
+	}
+
+	page->mtd = NULL;
+	ret = mtd_read(mtd, offset, page->size, &retlen, page->data);
+	if (ret || retlen != page->size) {
+		*err = ret ? ret : -EIO;
+		return NULL;
+	}
+
+	page->mtd = mtd;
+	page->offset = offset;
+	page->stamp = jiffies;
+	mtdsplit_cache_next = (mtdsplit_cache_next + 1) % MTDSPLIT_CACHE_PAGES;
+
+	return page;
+}
+
+/*
+ * mtd_read() for the small header reads done while probing. On NAND the
+ * page containing the header is cached, so further magic checks at the
+ * same place are served without touching the flash again.
+ */
+int mtdsplit_read(struct mtd_info *mtd, loff_t from, size_t len,
+		  size_t *retlen, u_char *buf)
+{
+	struct mtdsplit_cache_page *page;
+	loff_t offset;
+	int err = 0;
+
+	if (mtd->writesize < MTDSPLIT_CACHE_MIN_PAGE ||
+	    mtd->writesize > MTDSPLIT_CACHE_MAX_PAGE ||
+	    from < 0 || from + len > mtd->size)
+		return mtd_read(mtd, from, len, retlen, buf);
+
+	offset = from - mtd_mod_by_ws(from, mtd);
+	if (from + len > offset + mtd->writesize)
+		return mtd_read(mtd, from, len, retlen, buf);
+
+	mutex_lock(&mtdsplit_cache_lock);
+
+	if (mtdsplit_cache_disabled) {
+		mutex_unlock(&mtdsplit_cache_lock);
+		return mtd_read(mtd, from, len, retlen, buf);
+	}
+
+	page = mtdsplit_cache_lookup(mtd, offset);
+	if (!page)
+		page = mtdsplit_cache_fill(mtd, offset, &err);
+
+	if (page) {
+		memcpy(buf, page->data + (from - offset), len);
+		*retlen = len;
+	}
+
+	mutex_unlock(&mtdsplit_cache_lock);
+
+	if (err == -ENOMEM)
+		return mtd_read(mtd, from, len, retlen, buf);
+
+	if (err)
+		*retlen = 0;
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(mtdsplit_read);
+
+static int __init mtdsplit_cache_drop(void)
+{
+	int i;
+
+	mutex_lock(&mtdsplit_cache_lock);
+	for (i = 0; i < MTDSPLIT_CACHE_PAGES; i++) {
+		kfree(mtdsplit_cache[i].data);
+		memset(&mtdsplit_cache[i], 0, sizeof(mtdsplit_cache[i]));
+	}
+	mtdsplit_cache_disabled = true;
+	mutex_unlock(&mtdsplit_cache_lock);
+
+	return 0;
+}
+late_initcall_sync(mtdsplit_cache_drop);
+
 struct squashfs_super_block {
 	__le32 s_magic;
 	__le32 pad0[9];
@@ -38,7 +191,7 @@ int mtd_get_squashfs_len(struct mtd_info *master,
 	size_t retlen;
 	int err;
 
-	err = mtd_read(master, offset, sizeof(sb), &retlen, (void *)&sb);
+	err = mtdsplit_read(master, offset, sizeof(sb), &retlen, (void *)&sb);
 	if (err || (retlen != sizeof(sb))) {
 		pr_alert("error occured while reading from \"%s\"\n",
 			 master->name);
@@ -79,8 +232,8 @@ int mtd_check_rootfs_magic(struct mtd_info *mtd, size_t offset,
 	size_t retlen;
 	int ret;
 
-	ret = mtd_read(mtd, offset, sizeof(magic), &retlen,
-		       (unsigned char *) &magic);
+	ret = mtdsplit_read(mtd, offset, sizeof(magic), &retlen,
+			    (unsigned char *) &magic);
 	if (ret)
 		return ret;
 
@@ -116,6 +269,9 @@ int mtd_find_rootfs_from(struct mtd_info *mtd,
 
 	for (offset = from; offset < limit;
 	     offset = mtd_next_eb(mtd, offset)) {
+		if (mtd_can_have_bb(mtd) && mtd_block_isbad(mtd, offset) > 0)
+			continue;
+
 		err = mtd_check_rootfs_magic(mtd, offset, type);
 		if (err)
 			continue;
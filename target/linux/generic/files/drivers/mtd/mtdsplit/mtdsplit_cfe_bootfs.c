@@ -38,7 +38,7 @@ static int mtdsplit_cfe_bootfs_parse(struct mtd_info *mtd,
 	/* Find the end of JFFS2 bootfs partition */
 	offset = 0;
 	do {
-		err = mtd_read(mtd, offset, sizeof(node), &retlen, (void *)&node);
+		err = mtdsplit_read(mtd, offset, sizeof(node), &retlen, (void *)&node);
 		if (err || retlen != sizeof(node))
 			break;
 
@@ -63,7 +63,7 @@ static int mtdsplit_parse_wrgg(struct mtd_info *master,
 	int err;
 
 	hdr_len = sizeof(hdr);
-	err = mtd_read(master, 0, hdr_len, &retlen, (void *) &hdr);
+	err = mtdsplit_read(master, 0, hdr_len, &retlen, (void *) &hdr);
 	if (err)
 		return err;
 
@@ -34,7 +34,7 @@
  *   reorder the script as an lzma wrapper; do not depend on flash access
  */
 
-#include "LzmaDecode.h"
+#include "unlzma.h"
 
 #define KSEG0			0x80000000
 #define KSEG1			0xa0000000
@@ -78,24 +78,6 @@ static __inline__ void blast_dcache(unsigned long size, unsigned long lsize)
 	}
 }
 
-unsigned char *data;
-
-static int read_byte(void *object, unsigned char **buffer, UInt32 *bufferSize)
-{
-	*bufferSize = 1;
-	*buffer = data;
-	++data;
-	return LZMA_RESULT_OK;
-}
-
-static __inline__ unsigned char get_byte(void)
-{
-	unsigned char *buffer;
-	UInt32 fake;
-	
-	return read_byte(0, &buffer, &fake), *buffer;
-}
-
 /* This puts lzma workspace 128k below RAM end. 
  * That should be enough for both lzma and stack
  */
@@ -107,7 +89,6 @@ extern char lzma_end[];
 void entry(unsigned long icache_size, unsigned long icache_lsize, 
 	unsigned long dcache_size, unsigned long dcache_lsize)
 {
-	unsigned int i;  /* temp value */
 	unsigned int osize; /* uncompressed size */
 	volatile unsigned int arg0, arg1, arg2, arg3;
 
@@ -117,36 +98,9 @@ void entry(unsigned long icache_size, unsigned long icache_lsize,
 	__asm__ __volatile__ ("ori %0, $14, 0":"=r"(arg2));
 	__asm__ __volatile__ ("ori %0, $15, 0":"=r"(arg3));
 
-	ILzmaInCallback callback;
-	CLzmaDecoderState vs;
-	callback.Read = read_byte;
-
-	data = lzma_start;
-
-	/* lzma args */
-	i = get_byte();
-	vs.Properties.lc = i % 9, i = i / 9;
-	vs.Properties.lp = i % 5, vs.Properties.pb = i / 5;
-
-	vs.Probs = (CProb *)buffer;
-
-	/* skip rest of the LZMA coder property */
-	for (i = 0; i < 4; i++)
-		get_byte();
-
-	/* read the lower half of uncompressed size in the header */
-	osize = ((unsigned int)get_byte()) +
-		((unsigned int)get_byte() << 8) +
-		((unsigned int)get_byte() << 16) +
-		((unsigned int)get_byte() << 24);
-
-	/* skip rest of the header (upper half of uncompressed size) */
-	for (i = 0; i < 4; i++) 
-		get_byte();
-
 	/* decompress kernel */
-	if ((i = LzmaDecode(&vs, &callback,
-	(unsigned char*)KERNEL_ENTRY, osize, &osize)) == LZMA_RESULT_OK)
+	if (unlzma((unsigned char *)lzma_start, lzma_end - lzma_start,
+		   (unsigned char *)KERNEL_ENTRY, &osize, buffer) == LZMA_RESULT_OK)
 	{
 		blast_dcache(dcache_size, dcache_lsize);
 		blast_icache(icache_size, icache_lsize);
@@ -0,0 +1,103 @@
+/*
+ * Host build of the lzma-loader decode path
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Decompresses an lzma image the same way the loader does and reports the
+ * decoder throughput:
+ *	lzma-host <vmlinux.lzma> [output] [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "unlzma.h"
+
+/* Same workspace the loader reserves below the end of RAM */
+#define WORKSPACE_SIZE	0x00020000
+
+static unsigned char *read_file(const char *path, unsigned long *size)
+{
+	unsigned char *buf;
+	FILE *fp;
+	long len;
+
+	fp = fopen(path, "rb");
+	if (!fp)
+		return NULL;
+
+	fseek(fp, 0, SEEK_END);
+	len = ftell(fp);
+	rewind(fp);
+
+	buf = malloc(len);
+	if (buf && fread(buf, 1, len, fp) != (size_t)len) {
+		free(buf);
+		buf = NULL;
+	}
+	fclose(fp);
+
+	*size = len;
+	return buf;
+}
+
+int main(int argc, char **argv)
+{
+	static unsigned char workspace[WORKSPACE_SIZE];
+	unsigned long in_size;
+	unsigned char *in, *out;
+	unsigned int out_size;
+	struct timespec t0, t1;
+	double secs;
+	int iterations = 1;
+	int i;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <vmlinux.lzma> [output] [iterations]\n", argv[0]);
+		return 1;
+	}
+	if (argc > 3)
+		iterations = atoi(argv[3]);
+
+	in = read_file(argv[1], &in_size);
+	if (!in || in_size < UNLZMA_HEADER_SIZE) {
+		fprintf(stderr, "Failed to read %s\n", argv[1]);
+		return 1;
+	}
+
+	out_size = in[5] | in[6] << 8 | in[7] << 16 | (unsigned int)in[8] << 24;
+	out = malloc(out_size);
+	if (!out) {
+		fprintf(stderr, "Failed to allocate %u bytes\n", out_size);
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < iterations; i++) {
+		if (unlzma(in, in_size, out, &out_size, workspace) != LZMA_RESULT_OK) {
+			fprintf(stderr, "Failed to decompress %s\n", argv[1]);
+			return 1;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+	printf("%u bytes, %.3f s, %.1f MB/s\n", out_size, secs / iterations,
+	       (double)out_size * iterations / secs / 1e6);
+
+	if (argc > 2 && argv[2][0]) {
+		FILE *fp = fopen(argv[2], "wb");
+
+		if (!fp || fwrite(out, 1, out_size, fp) != out_size) {
+			fprintf(stderr, "Failed to write %s\n", argv[2]);
+			return 1;
+		}
+		fclose(fp);
+	}
+
+	return 0;
+}
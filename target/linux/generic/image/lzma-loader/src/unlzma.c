@@ -0,0 +1,81 @@
+/*
+ * LZMA decode path shared by the loader and its host build
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Two backends of LzmaDecode can be selected at build time:
+ *  - default: the whole compressed image is handed to the decoder at once
+ *    so the range coder reads input straight from memory
+ *  - _LZMA_IN_CB: the decoder pulls input through a callback, one byte
+ *    per call (the historical behaviour)
+ */
+
+#include "unlzma.h"
+
+static unsigned char *data;
+
+#ifdef _LZMA_IN_CB
+static int read_byte(void *object, const unsigned char **buffer, SizeT *bufferSize)
+{
+	*bufferSize = 1;
+	*buffer = data;
+	++data;
+	return LZMA_RESULT_OK;
+}
+#endif
+
+static __inline__ unsigned char get_byte(void)
+{
+	return *data++;
+}
+
+int unlzma(unsigned char *in, unsigned long in_size, unsigned char *out,
+	   unsigned int *out_size, void *workspace)
+{
+	CLzmaDecoderState vs;
+	unsigned int osize; /* uncompressed size */
+	unsigned int i;  /* temp value */
+#ifdef _LZMA_IN_CB
+	ILzmaInCallback callback;
+#else
+	SizeT isize;
+#endif
+
+	if (in_size < UNLZMA_HEADER_SIZE)
+		return LZMA_RESULT_DATA_ERROR;
+
+	data = in;
+
+	/* lzma args */
+	i = get_byte();
+	vs.Properties.lc = i % 9, i = i / 9;
+	vs.Properties.lp = i % 5, vs.Properties.pb = i / 5;
+
+	vs.Probs = (CProb *)workspace;
+
+	/* skip rest of the LZMA coder property */
+	for (i = 0; i < 4; i++)
+		get_byte();
+
+	/* read the lower half of uncompressed size in the header */
+	osize = ((unsigned int)get_byte()) +
+		((unsigned int)get_byte() << 8) +
+		((unsigned int)get_byte() << 16) +
+		((unsigned int)get_byte() << 24);
+
+	/* skip rest of the header (upper half of uncompressed size) */
+	for (i = 0; i < 4; i++)
+		get_byte();
+
+	/* decompress kernel */
+#ifdef _LZMA_IN_CB
+	callback.Read = read_byte;
+	return LzmaDecode(&vs, &callback, out, osize, out_size);
+#else
+	return LzmaDecode(&vs, data, in_size - UNLZMA_HEADER_SIZE, &isize,
+			  out, osize, out_size);
+#endif
+}
@@ -0,0 +1,26 @@
+/*
+ * LZMA decode path shared by the loader and its host build
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+
+#ifndef __UNLZMA_H
+#define __UNLZMA_H
+
+#include "LzmaDecode.h"
+
+/* lzma "alone" header: properties, dictionary size, 64 bit output size */
+#define UNLZMA_HEADER_SIZE	13
+
+/*
+ * Decompress an lzma stream located at in into out. The uncompressed size
+ * is taken from the stream header and returned in out_size. workspace has
+ * to be big enough for the decoder probabilities (see LzmaGetNumProbs).
+ */
+int unlzma(unsigned char *in, unsigned long in_size, unsigned char *out,
+	   unsigned int *out_size, void *workspace);
+
+#endif
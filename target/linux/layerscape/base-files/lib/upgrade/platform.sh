@@ -3,7 +3,7 @@
 # Copyright 2020 NXP
 #
 
-RAMFS_COPY_BIN="/usr/sbin/fw_printenv /usr/sbin/fw_setenv /usr/sbin/ubinfo /bin/echo"
+RAMFS_COPY_BIN="/usr/sbin/fw_printenv /usr/sbin/fw_setenv /usr/sbin/ubinfo /usr/sbin/blkwrite /bin/echo"
 RAMFS_COPY_DATA="/etc/fw_env.config /var/lock/fw_printenv.lock"
 
 REQUIRE_IMAGE_METADATA=1
@@ -26,10 +26,21 @@ platform_do_upgrade_sdboot() {
 		umount /mnt
 	fi
 
-	echo "Erasing rootfs..."
-	dd if=/dev/zero of=/dev/mmcblk0p2 bs=1M > /dev/null 2>&1
-	echo "Writing rootfs..."
-	tar xf $tar_file ${board_dir}/root -O  | dd of=/dev/mmcblk0p2 bs=512k > /dev/null 2>&1
+	if [ -x /usr/sbin/blkwrite ]; then
+		# Rewrite changed chunks only, zero the area where a stale
+		# overlay could be found and discard the rest of the partition
+		echo "Writing rootfs..."
+		tar xf $tar_file ${board_dir}/root -O | \
+			blkwrite -D -s -V -z 1M -d /dev/mmcblk0p2 > /dev/null || {
+			echo "Failed to write rootfs"
+			return 1
+		}
+	else
+		echo "Erasing rootfs..."
+		dd if=/dev/zero of=/dev/mmcblk0p2 bs=1M > /dev/null 2>&1
+		echo "Writing rootfs..."
+		tar xf $tar_file ${board_dir}/root -O  | dd of=/dev/mmcblk0p2 bs=512k > /dev/null 2>&1
+	fi
 
 }
 platform_do_upgrade_traverse_nandubi() {
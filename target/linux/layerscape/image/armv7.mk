@@ -23,6 +23,7 @@ define Device/fsl-sdboot
   KERNEL = kernel-bin | gzip | fit gzip $$(DTS_DIR)/$$(DEVICE_DTS).dtb
   IMAGES := sdcard.img.gz sysupgrade.bin
   IMAGE/sysupgrade.bin := sysupgrade-tar | append-metadata
+  DEVICE_PACKAGES += blkwrite
 endef
 
 define Device/fsl_ls1021a-twr
@@ -51,11 +52,11 @@ define Device/fsl_ls1021a-twr-sdboot
   DEVICE_DTS := ls1021a-twr
   IMAGE/sdcard.img.gz := \
     ls-clean | \
-    ls-append-sdhead $(1) | pad-to 4K | \
-    ls-append $(1)-uboot.bin | pad-to 3M | \
-    ls-append $(1)-uboot-env.bin | pad-to 16M | \
-    ls-append-kernel | pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
-    append-rootfs | pad-to $(LS_SD_IMAGE_SIZE)M | gzip
+    ls-append-sdhead $(1) | ls-pad-to 4K | \
+    ls-append $(1)-uboot.bin | ls-pad-to 3M | \
+    ls-append $(1)-uboot-env.bin | ls-pad-to 16M | \
+    ls-append-kernel | ls-pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
+    ls-append-rootfs | ls-pad-to $(LS_SD_IMAGE_SIZE)M | ls-gzip
 endef
 TARGET_DEVICES += fsl_ls1021a-twr-sdboot
 
@@ -69,11 +70,11 @@ define Device/fsl_ls1021a-iot-sdboot
   SUPPORTED_DEVICES :=
   IMAGE/sdcard.img.gz := \
     ls-clean | \
-    ls-append-sdhead $(1) | pad-to 4K | \
-    ls-append $(1)-uboot.bin | pad-to 1M | \
-    ls-append $(1)-uboot-env.bin | pad-to 16M | \
-    ls-append-kernel | pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
-    append-rootfs | pad-to $(LS_SD_IMAGE_SIZE)M | gzip
+    ls-append-sdhead $(1) | ls-pad-to 4K | \
+    ls-append $(1)-uboot.bin | ls-pad-to 1M | \
+    ls-append $(1)-uboot-env.bin | ls-pad-to 16M | \
+    ls-append-kernel | ls-pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
+    ls-append-rootfs | ls-pad-to $(LS_SD_IMAGE_SIZE)M | ls-gzip
 endef
 TARGET_DEVICES += fsl_ls1021a-iot-sdboot
 
@@ -87,11 +88,11 @@ define Device/avs_smart-sdboot
   SUPPORTED_DEVICES :=
   IMAGE/sdcard.img.gz := \
     ls-clean | \
-    ls-append-sdhead $(1) | pad-to 4K | \
-    ls-append $(1)-uboot.bin | pad-to 1M | \
-    ls-append $(1)-uboot-env.bin | pad-to 16M | \
-    ls-append-kernel | pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
-    append-rootfs | pad-to $(LS_SD_IMAGE_SIZE)M | gzip
+    ls-append-sdhead $(1) | ls-pad-to 4K | \
+    ls-append $(1)-uboot.bin | ls-pad-to 1M | \
+    ls-append $(1)-uboot-env.bin | ls-pad-to 16M | \
+    ls-append-kernel | ls-pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
+    ls-append-rootfs | ls-pad-to $(LS_SD_IMAGE_SIZE)M | ls-gzip
 endef
 TARGET_DEVICES += avs_smart-sdboot
 
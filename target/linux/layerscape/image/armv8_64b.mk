@@ -26,6 +26,7 @@ define Device/fsl-sdboot
   KERNEL = kernel-bin | gzip | fit gzip $$(DTS_DIR)/$$(DEVICE_DTS).dtb
   IMAGES := sdcard.img.gz sysupgrade.bin
   IMAGE/sysupgrade.bin := sysupgrade-tar | append-metadata
+  DEVICE_PACKAGES += blkwrite
 endef
 
 define Device/fsl_ls1012a-frdm
@@ -97,9 +98,9 @@ define Device/fsl_ls1012a-frwy-sdboot
     check-size 2097153
   IMAGE/sdcard.img.gz := \
     ls-clean | \
-    ls-append-sdhead $(1) | pad-to 16M | \
-    ls-append-kernel | pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
-    append-rootfs | pad-to $(LS_SD_IMAGE_SIZE)M | gzip
+    ls-append-sdhead $(1) | ls-pad-to 16M | \
+    ls-append-kernel | ls-pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
+    ls-append-rootfs | ls-pad-to $(LS_SD_IMAGE_SIZE)M | ls-gzip
 endef
 TARGET_DEVICES += fsl_ls1012a-frwy-sdboot
 
@@ -152,13 +153,13 @@ else
 endif
   IMAGE/sdcard.img.gz := \
     ls-clean | \
-    ls-append-sdhead $(1) | pad-to 4K | \
-    ls-append $(1)-bl2.pbl | pad-to 1M | \
-    ls-append $(1)-fip.bin | pad-to 5M | \
-    ls-append $(1)-uboot-env.bin | pad-to 9M | \
-    ls-append fsl_ls1043a-rdb-fman.bin | pad-to 16M | \
-    ls-append-kernel | pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
-    append-rootfs | pad-to $(LS_SD_IMAGE_SIZE)M | gzip
+    ls-append-sdhead $(1) | ls-pad-to 4K | \
+    ls-append $(1)-bl2.pbl | ls-pad-to 1M | \
+    ls-append $(1)-fip.bin | ls-pad-to 5M | \
+    ls-append $(1)-uboot-env.bin | ls-pad-to 9M | \
+    ls-append fsl_ls1043a-rdb-fman.bin | ls-pad-to 16M | \
+    ls-append-kernel | ls-pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
+    ls-append-rootfs | ls-pad-to $(LS_SD_IMAGE_SIZE)M | ls-gzip
 endef
 TARGET_DEVICES += fsl_ls1043a-rdb-sdboot
 
@@ -201,13 +202,13 @@ else
 endif
   IMAGE/sdcard.img.gz := \
     ls-clean | \
-    ls-append-sdhead $(1) | pad-to 4K | \
-    ls-append $(1)-bl2.pbl | pad-to 1M | \
-    ls-append $(1)-fip.bin | pad-to 5M | \
-    ls-append $(1)-uboot-env.bin | pad-to 9M | \
-    ls-append fsl_ls1046a-rdb-fman.bin | pad-to 16M | \
-    ls-append-kernel | pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
-    append-rootfs | pad-to $(LS_SD_IMAGE_SIZE)M | gzip
+    ls-append-sdhead $(1) | ls-pad-to 4K | \
+    ls-append $(1)-bl2.pbl | ls-pad-to 1M | \
+    ls-append $(1)-fip.bin | ls-pad-to 5M | \
+    ls-append $(1)-uboot-env.bin | ls-pad-to 9M | \
+    ls-append fsl_ls1046a-rdb-fman.bin | ls-pad-to 16M | \
+    ls-append-kernel | ls-pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
+    ls-append-rootfs | ls-pad-to $(LS_SD_IMAGE_SIZE)M | ls-gzip
 endef
 TARGET_DEVICES += fsl_ls1046a-frwy-sdboot
 
@@ -260,13 +261,13 @@ else
 endif
   IMAGE/sdcard.img.gz := \
     ls-clean | \
-    ls-append-sdhead $(1) | pad-to 4K | \
-    ls-append $(1)-bl2.pbl | pad-to 1M | \
-    ls-append $(1)-fip.bin | pad-to 5M | \
-    ls-append $(1)-uboot-env.bin | pad-to 9M | \
-    ls-append fsl_ls1046a-rdb-fman.bin | pad-to 16M | \
-    ls-append-kernel | pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
-    append-rootfs | pad-to $(LS_SD_IMAGE_SIZE)M | gzip
+    ls-append-sdhead $(1) | ls-pad-to 4K | \
+    ls-append $(1)-bl2.pbl | ls-pad-to 1M | \
+    ls-append $(1)-fip.bin | ls-pad-to 5M | \
+    ls-append $(1)-uboot-env.bin | ls-pad-to 9M | \
+    ls-append fsl_ls1046a-rdb-fman.bin | ls-pad-to 16M | \
+    ls-append-kernel | ls-pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
+    ls-append-rootfs | ls-pad-to $(LS_SD_IMAGE_SIZE)M | ls-gzip
 endef
 TARGET_DEVICES += fsl_ls1046a-rdb-sdboot
 
@@ -314,15 +315,15 @@ define Device/fsl_ls1088a-rdb-sdboot
   DEVICE_DTS := freescale/fsl-ls1088a-rdb
   IMAGE/sdcard.img.gz := \
     ls-clean | \
-    ls-append-sdhead $(1) | pad-to 4K | \
-    ls-append $(1)-bl2.pbl | pad-to 1M | \
-    ls-append $(1)-fip.bin | pad-to 5M | \
-    ls-append $(1)-uboot-env.bin | pad-to 10M | \
-    ls-append fsl_ls1088a-rdb-mc.itb | pad-to 13M | \
-    ls-append fsl_ls1088a-rdb-dpl.dtb | pad-to 14M | \
-    ls-append fsl_ls1088a-rdb-dpc.dtb | pad-to 16M | \
-    ls-append-kernel | pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
-    append-rootfs | pad-to $(LS_SD_IMAGE_SIZE)M | gzip
+    ls-append-sdhead $(1) | ls-pad-to 4K | \
+    ls-append $(1)-bl2.pbl | ls-pad-to 1M | \
+    ls-append $(1)-fip.bin | ls-pad-to 5M | \
+    ls-append $(1)-uboot-env.bin | ls-pad-to 10M | \
+    ls-append fsl_ls1088a-rdb-mc.itb | ls-pad-to 13M | \
+    ls-append fsl_ls1088a-rdb-dpl.dtb | ls-pad-to 14M | \
+    ls-append fsl_ls1088a-rdb-dpc.dtb | ls-pad-to 16M | \
+    ls-append-kernel | ls-pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
+    ls-append-rootfs | ls-pad-to $(LS_SD_IMAGE_SIZE)M | ls-gzip
 endef
 TARGET_DEVICES += fsl_ls1088a-rdb-sdboot
 
@@ -389,16 +390,16 @@ define Device/fsl_lx2160a-rdb-sdboot
   DEVICE_DTS := freescale/fsl-lx2160a-rdb
   IMAGE/sdcard.img.gz := \
     ls-clean | \
-    ls-append-sdhead $(1) | pad-to 4K | \
-    ls-append $(1)-bl2.pbl | pad-to 1M | \
-    ls-append $(1)-fip.bin | pad-to 5M | \
-    ls-append $(1)-uboot-env.bin | pad-to 8M | \
-    ls-append fsl_lx2160a-rdb-fip_ddr_all.bin | pad-to 10M | \
-    ls-append fsl_lx2160a-rdb-mc.itb | pad-to 13M | \
-    ls-append fsl_lx2160a-rdb-dpl.dtb | pad-to 14M | \
-    ls-append fsl_lx2160a-rdb-dpc.dtb | pad-to 16M | \
-    ls-append-kernel | pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
-    append-rootfs | pad-to $(LS_SD_IMAGE_SIZE)M | gzip
+    ls-append-sdhead $(1) | ls-pad-to 4K | \
+    ls-append $(1)-bl2.pbl | ls-pad-to 1M | \
+    ls-append $(1)-fip.bin | ls-pad-to 5M | \
+    ls-append $(1)-uboot-env.bin | ls-pad-to 8M | \
+    ls-append fsl_lx2160a-rdb-fip_ddr_all.bin | ls-pad-to 10M | \
+    ls-append fsl_lx2160a-rdb-mc.itb | ls-pad-to 13M | \
+    ls-append fsl_lx2160a-rdb-dpl.dtb | ls-pad-to 14M | \
+    ls-append fsl_lx2160a-rdb-dpc.dtb | ls-pad-to 16M | \
+    ls-append-kernel | ls-pad-to $(LS_SD_ROOTFSPART_OFFSET)M | \
+    ls-append-rootfs | ls-pad-to $(LS_SD_IMAGE_SIZE)M | ls-gzip
 endef
 TARGET_DEVICES += fsl_lx2160a-rdb-sdboot
 
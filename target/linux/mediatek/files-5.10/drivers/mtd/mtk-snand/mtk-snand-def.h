@@ -86,6 +86,9 @@ struct snand_mem_org {
 
 typedef int (*snand_select_die_t)(struct mtk_snand *snf, uint32_t dieidx);
 
+/* Supports page read cache sequential (31h) / last (3Fh) */
+#define SNAND_F_READ_CACHE_SEQ		BIT(0)
+
 struct snand_flash_info {
 	const char *model;
 	struct snand_id id;
@@ -93,6 +96,7 @@ struct snand_flash_info {
 	const struct snand_io_cap *cap_rd;
 	const struct snand_io_cap *cap_pl;
 	snand_select_die_t select_die;
+	uint32_t flags;
 };
 
 #define SNAND_INFO(_model, _id, _memorg, _cap_rd, _cap_pl, ...) \
@@ -151,6 +155,7 @@ struct mtk_snand {
 
 	uint32_t num_dies;
 	snand_select_die_t select_die;
+	uint32_t flags;
 
 	uint8_t opcode_rfc;
 	uint8_t opcode_pl;
@@ -172,6 +177,12 @@ struct mtk_snand {
 	uint32_t ecc_bytes;
 	uint32_t ecc_parity_bits;
 
+	/* Sequential cache read state */
+	uint64_t read_end;	/* End of the range announced for reading */
+	uint64_t seq_addr;	/* Page being loaded into the data register */
+	uint32_t seq_page;
+	bool seq_active;
+
 	uint8_t *page_cache;	/* Used by read/write page */
 	uint8_t *buf_cache;	/* Used by block bad/markbad & auto_oob */
 	int *sect_bf;		/* Used by ECC correction */
@@ -239,8 +250,10 @@ static inline int mtk_snand_ffs64(uint64_t x)
 #define SNAND_CMD_READ_FROM_CACHE_DUAL	0xbb
 #define SNAND_CMD_READID		0x9f
 #define SNAND_CMD_READ_FROM_CACHE_X4	0x6b
+#define SNAND_CMD_READ_CACHE_LAST	0x3f
 #define SNAND_CMD_READ_FROM_CACHE_X2	0x3b
 #define SNAND_CMD_PROGRAM_LOAD_X4	0x32
+#define SNAND_CMD_READ_CACHE_SEQ	0x31
 #define SNAND_CMD_SET_FEATURE		0x1f
 #define SNAND_CMD_READ_TO_CACHE		0x13
 #define SNAND_CMD_PROGRAM_EXECUTE	0x10
@@ -102,6 +102,7 @@ static int mtk_snand_mtd_read_data(struct mtk_snand_mtd *msm, uint64_t addr,
 	uint8_t *datcache, *oobcache;
 	bool ecc_failed = false, raw = ops->mode == MTD_OPS_RAW ? true : false;
 	int ret, max_bitflips = 0;
+	uint32_t pages = 0;
 
 	col = addr & mtd->writesize_mask;
 	addr &= ~mtd->writesize_mask;
@@ -116,6 +117,16 @@ static int mtk_snand_mtd_read_data(struct mtk_snand_mtd *msm, uint64_t addr,
 	ops->oobretlen = 0;
 	ops->retlen = 0;
 
+	/* Let the chip chain cache reads over the pages of this request */
+	if (len)
+		pages = DIV_ROUND_UP(col + len, mtd->writesize);
+	if (ooblen)
+		pages = max_t(uint32_t, pages,
+			      DIV_ROUND_UP(ooboffs + ooblen, maxooblen));
+	if (pages > 1)
+		mtk_snand_read_range(msm->snf, addr,
+				     (uint64_t)pages << mtd->writesize_shift);
+
 	while (len || ooblen) {
 		if (ops->mode == MTD_OPS_AUTO_OOB)
 			ret = mtk_snand_read_page_auto_oob(msm->snf, addr,
@@ -125,7 +136,7 @@ static int mtk_snand_mtd_read_data(struct mtk_snand_mtd *msm, uint64_t addr,
 				oobcache, raw);
 
 		if (ret < 0 && ret != -EBADMSG)
-			return ret;
+			goto out;
 
 		if (ret == -EBADMSG) {
 			mtd->ecc_stats.failed++;
@@ -164,7 +175,13 @@ static int mtk_snand_mtd_read_data(struct mtk_snand_mtd *msm, uint64_t addr,
 		addr += mtd->writesize;
 	}
 
-	return ecc_failed ? -EBADMSG : max_bitflips;
+	ret = ecc_failed ? -EBADMSG : max_bitflips;
+
+out:
+	if (pages > 1)
+		mtk_snand_read_range(msm->snf, 0, 0);
+
+	return ret;
 }
 
 static int mtk_snand_mtd_read_oob(struct mtd_info *mtd, loff_t from,
@@ -447,6 +447,8 @@ int mtk_snand_chip_reset(struct mtk_snand *snf)
 	uint8_t op = SNAND_CMD_RESET;
 	int ret;
 
+	snf->seq_active = false;
+
 	ret = mtk_snand_mac_io(snf, &op, 1, NULL, 0);
 	if (ret)
 		return ret;
@@ -852,13 +854,78 @@ static void mtk_snand_from_raw_page(struct mtk_snand *snf, void *buf, void *oob)
 	}
 }
 
-static int mtk_snand_do_read_page(struct mtk_snand *snf, uint64_t addr,
-				  void *buf, void *oob, bool raw, bool format)
+static int mtk_snand_read_seq_end(struct mtk_snand *snf)
+{
+	uint8_t op = SNAND_CMD_READ_CACHE_LAST;
+	int ret;
+
+	if (!snf->seq_active)
+		return 0;
+
+	snf->seq_active = false;
+
+	/* Move the pending page to cache and leave cache read mode */
+	ret = mtk_snand_mac_io(snf, &op, 1, NULL, 0);
+	if (ret)
+		return ret;
+
+	ret = mtk_snand_poll_status(snf, SNFI_POLL_INTERVAL);
+	if (ret < 0) {
+		snand_log_chip(snf->pdev, "Read cache last command timed out\n");
+		return ret;
+	}
+
+	return 0;
+}
+
+static bool mtk_snand_read_seq_next(struct mtk_snand *snf, uint64_t addr)
+{
+	uint64_t next = addr + snf->writesize;
+
+	/* Only chain pages within a block of the announced read range */
+	if (!(snf->flags & SNAND_F_READ_CACHE_SEQ))
+		return false;
+
+	return next < snf->read_end && (next & snf->erasesize_mask);
+}
+
+static int mtk_snand_load_page(struct mtk_snand *snf, uint64_t addr,
+			       uint32_t *ppage)
 {
 	uint64_t die_addr;
 	uint32_t page;
+	uint8_t op;
 	int ret;
 
+	if (snf->seq_active && snf->seq_addr == addr) {
+		/*
+		 * The page is already in the data register. Move it to cache
+		 * and let the chip load the next one while we transfer.
+		 */
+		page = snf->seq_page;
+
+		if (mtk_snand_read_seq_next(snf, addr)) {
+			op = SNAND_CMD_READ_CACHE_SEQ;
+			snf->seq_addr += snf->writesize;
+			snf->seq_page++;
+		} else {
+			op = SNAND_CMD_READ_CACHE_LAST;
+			snf->seq_active = false;
+		}
+
+		ret = mtk_snand_mac_io(snf, &op, 1, NULL, 0);
+		if (ret) {
+			snf->seq_active = false;
+			return ret;
+		}
+
+		goto wait;
+	}
+
+	ret = mtk_snand_read_seq_end(snf);
+	if (ret)
+		return ret;
+
 	die_addr = mtk_snand_select_die_address(snf, addr);
 	page = die_addr >> snf->writesize_shift;
 
@@ -872,6 +939,43 @@ static int mtk_snand_do_read_page(struct mtk_snand *snf, uint64_t addr,
 		return ret;
 	}
 
+	if (!mtk_snand_read_seq_next(snf, addr)) {
+		*ppage = page;
+		return 0;
+	}
+
+	/* Start loading the next page into the data register */
+	op = SNAND_CMD_READ_CACHE_SEQ;
+	ret = mtk_snand_mac_io(snf, &op, 1, NULL, 0);
+	if (ret)
+		return ret;
+
+	snf->seq_active = true;
+	snf->seq_addr = addr + snf->writesize;
+	snf->seq_page = page + 1;
+
+wait:
+	ret = mtk_snand_poll_status(snf, SNFI_POLL_INTERVAL);
+	if (ret < 0) {
+		snf->seq_active = false;
+		snand_log_chip(snf->pdev, "Read cache command timed out\n");
+		return ret;
+	}
+
+	*ppage = page;
+	return 0;
+}
+
+static int mtk_snand_do_read_page(struct mtk_snand *snf, uint64_t addr,
+				  void *buf, void *oob, bool raw, bool format)
+{
+	uint32_t page;
+	int ret;
+
+	ret = mtk_snand_load_page(snf, addr, &page);
+	if (ret)
+		return ret;
+
 	ret = mtk_snand_read_cache(snf, page, raw);
 	if (ret < 0 && ret != -EBADMSG)
 		return ret;
@@ -920,6 +1024,29 @@ int mtk_snand_read_page(struct mtk_snand *snf, uint64_t addr, void *buf,
 	return mtk_snand_do_read_page(snf, addr, buf, oob, raw, true);
 }
 
+/*
+ * Announce that the pages in [addr, addr + len) are going to be read in
+ * order, which lets chips supporting it overlap the array load of the next
+ * page with the transfer of the current one. A zero length ends the range.
+ */
+int mtk_snand_read_range(struct mtk_snand *snf, uint64_t addr, uint64_t len)
+{
+	if (!snf)
+		return -EINVAL;
+
+	if (!len) {
+		snf->read_end = 0;
+		return mtk_snand_read_seq_end(snf);
+	}
+
+	if (addr >= snf->size || len > snf->size - addr)
+		return -EINVAL;
+
+	snf->read_end = addr + len;
+
+	return 0;
+}
+
 static void mtk_snand_write_fdm(struct mtk_snand *snf, const uint8_t *buf)
 {
 	uint32_t vall, valm, fdm_size = snf->nfi_soc->fdm_size;
@@ -1123,6 +1250,10 @@ static int mtk_snand_do_write_page(struct mtk_snand *snf, uint64_t addr,
 	uint32_t page;
 	int ret;
 
+	ret = mtk_snand_read_seq_end(snf);
+	if (ret)
+		return ret;
+
 	die_addr = mtk_snand_select_die_address(snf, addr);
 	page = die_addr >> snf->writesize_shift;
 
@@ -1222,6 +1353,10 @@ int mtk_snand_erase_block(struct mtk_snand *snf, uint64_t addr)
 	if (addr >= snf->size)
 		return -EINVAL;
 
+	ret = mtk_snand_read_seq_end(snf);
+	if (ret)
+		return ret;
+
 	die_addr = mtk_snand_select_die_address(snf, addr);
 	block = die_addr >> snf->erasesize_shift;
 	page = block << (snf->erasesize_shift - snf->writesize_shift);
@@ -1658,6 +1793,9 @@ static int mtk_snand_setup(struct mtk_snand *snf,
 	snf->die_shift = mtk_snand_ffs64(snf->die_size) - 1;
 
 	snf->select_die = snand_info->select_die;
+	snf->flags = snand_info->flags;
+	snf->read_end = 0;
+	snf->seq_active = false;
 
 	/* Determine opcodes for read from cache/program load */
 	snfi_caps = SPI_IO_1_1_1 | SPI_IO_1_1_2 | SPI_IO_1_2_2;
@@ -7,6 +7,7 @@
  *
  */
 
+#define _GNU_SOURCE
 #include <errno.h>
 #include <fcntl.h>
 #include <libgen.h>
@@ -18,6 +19,7 @@
 #include <stdbool.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 
 static char *progname;
 static unsigned int xtra_offset;
@@ -44,44 +46,209 @@ static bool pad_to_stdout = false;
 #define BUF_SIZE	(64 * 1024)
 #define ALIGN(_x,_y)	(((_x) + ((_y) - 1)) & ~((_y) - 1))
 
+/* padding runs at least this long are duplicated inside the output file */
+#define COPY_MIN	(1024 * 1024)
+#define IOV_CNT		256
+#define MAX_PADS	32
+
+/* copy_file_range() needs Linux and glibc >= 2.27 (or musl), other hosts
+ * write the whole fill */
+#if defined(__linux__) && defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 27)
+#define HAVE_COPY_FILE_RANGE
+#endif
+#elif defined(__linux__)
+#define HAVE_COPY_FILE_RANGE
+#endif
+
+struct pad_region {
+	off_t offset;	/* start of the 0xff fill */
+	off_t len;	/* length of the fill, the marker follows it */
+};
+
+static char *map_file;
+static unsigned char ff_buf[BUF_SIZE];
+
+static int write_iov(int fd, struct iovec *iov, int cnt, off_t *pos,
+		     bool seekable)
+{
+	ssize_t t;
+
+	/* copy_fill() leaves the file offset alone, so one seek is enough */
+	if (seekable && cnt > 0 && lseek(fd, *pos, SEEK_SET) < 0)
+		return -1;
+
+	while (cnt > 0) {
+		t = writev(fd, iov, cnt);
+		if (t < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		*pos += t;
+
+		while (cnt > 0 && t >= (ssize_t) iov->iov_len) {
+			t -= iov->iov_len;
+			iov++;
+			cnt--;
+		}
+		if (cnt > 0) {
+			iov->iov_base = (char *) iov->iov_base + t;
+			iov->iov_len -= t;
+		}
+	}
+
+	return 0;
+}
+
+#ifdef HAVE_COPY_FILE_RANGE
+/* fill [pos, pos + len) with 0xff by copying already written fill */
+static int copy_fill(int fd, off_t pos, off_t len)
+{
+	off_t done = BUF_SIZE;
+
+	if (pwrite(fd, ff_buf, BUF_SIZE, pos) != BUF_SIZE)
+		return -1;
+
+	while (done < len) {
+		loff_t in = pos, out = pos + done;
+		size_t chunk = (done < len - done) ? done : len - done;
+		ssize_t t;
+
+		t = copy_file_range(fd, &in, fd, &out, chunk, 0);
+		if (t <= 0)
+			return -1;
+
+		done += t;
+	}
+
+	return 0;
+}
+#endif
+
+static int write_pads(int fd, off_t pos, struct pad_region *pads, int n_pads,
+		      bool seekable)
+{
+	struct iovec iov[IOV_CNT];
+	int cnt = 0;
+	int i;
+
+	for (i = 0; i < n_pads; i++) {
+		off_t len = pads[i].len;
+
+#ifdef HAVE_COPY_FILE_RANGE
+		if (seekable && len >= COPY_MIN) {
+			if (write_iov(fd, iov, cnt, &pos, seekable))
+				return -1;
+			cnt = 0;
+
+			if (!copy_fill(fd, pos, len)) {
+				pos += len;
+				len = 0;
+			}
+		}
+#endif
+
+		while (len > 0) {
+			size_t chunk = len > BUF_SIZE ? BUF_SIZE : len;
+
+			iov[cnt].iov_base = ff_buf;
+			iov[cnt].iov_len = chunk;
+			len -= chunk;
+
+			if (++cnt == IOV_CNT) {
+				if (write_iov(fd, iov, cnt, &pos, seekable))
+					return -1;
+				cnt = 0;
+			}
+		}
+
+		/* JFFS end-of-filesystem marker */
+		iov[cnt].iov_base = pad;
+		iov[cnt].iov_len = pad_len;
+		if (++cnt == IOV_CNT) {
+			if (write_iov(fd, iov, cnt, &pos, seekable))
+				return -1;
+			cnt = 0;
+		}
+	}
+
+	return write_iov(fd, iov, cnt, &pos, seekable);
+}
+
+static int write_map(off_t out_len, struct pad_region *pads, int n_pads)
+{
+	FILE *f;
+	int i;
+
+	f = fopen(map_file, "w");
+	if (!f) {
+		ERRS("Unable to open %s", map_file);
+		return -1;
+	}
+
+	fprintf(f, "# padjffs2 pad map\n");
+	fprintf(f, "ImageSize %lld\n", (long long) out_len);
+	for (i = 0; i < n_pads; i++) {
+		if (!pads[i].len)
+			continue;
+
+		fprintf(f, "Pad %lld %lld\n", (long long) pads[i].offset,
+			(long long) pads[i].len);
+	}
+
+	if (fclose(f)) {
+		ERRS("Unable to write %s", map_file);
+		return -1;
+	}
+
+	return 0;
+}
+
 static int pad_image(char *name, uint32_t pad_mask)
 {
-	char *buf;
+	struct pad_region pads[MAX_PADS];
+	int n_pads = 0;
+	bool seekable;
+	off_t pos = 0;
 	int fd;
 	int outfd;
 	ssize_t in_len;
 	ssize_t out_len;
 	int ret = -1;
 
-	buf = malloc(BUF_SIZE);
-	if (!buf) {
-		ERR("No memory for buffer");
-		goto out;
-	}
-
 	fd = open(name, O_RDWR);
 	if (fd < 0) {
 		ERRS("Unable to open %s", name);
-		goto free_buf;
+		goto out;
 	}
 
 	in_len = lseek(fd, 0, SEEK_END);
 	if (in_len < 0)
 		goto close;
 
-	if (!pad_to_stdout)
+	/*
+	 * Only the image opened here is written at explicit offsets. stdout
+	 * may be shared with other writers or opened with O_APPEND, so it is
+	 * always streamed.
+	 */
+	if (!pad_to_stdout) {
 		outfd = fd;
-	else
+		pos = in_len;
+		seekable = true;
+	} else {
 		outfd = STDOUT_FILENO;
+		seekable = false;
+	}
 
-	memset(buf, '\xff', BUF_SIZE);
+	memset(ff_buf, '\xff', BUF_SIZE);
 
 	in_len += xtra_offset;
 
+	/* work out all pad regions first */
 	out_len = in_len;
 	while (pad_mask) {
 		uint32_t mask;
-		ssize_t t;
 		int i;
 
 		for (i = 10; i < 32; i++) {
@@ -100,37 +267,35 @@ static int pad_image(char *name, uint32_t pad_mask)
 
 		fprintf(stderr, "padding image to %08x\n", (unsigned int) in_len - xtra_offset);
 
-		while (out_len < in_len) {
-			ssize_t len;
+		pads[n_pads].offset = out_len - xtra_offset;
+		pads[n_pads].len = in_len - out_len;
+		n_pads++;
 
-			len = in_len - out_len;
-			if (len > BUF_SIZE)
-				len = BUF_SIZE;
-
-			t = write(outfd, buf, len);
-			if (t != len) {
-				ERRS("Unable to write to %s", name);
-				goto close;
-			}
+		out_len = in_len + pad_len;
+	}
 
-			out_len += len;
-		}
+#ifdef __linux__
+	/* reserve the space up front to keep the file in one piece */
+	if (seekable && out_len > in_len)
+		fallocate(outfd, FALLOC_FL_KEEP_SIZE, pos,
+			  out_len - (pads[0].offset + xtra_offset));
+#endif
 
-		/* write out the JFFS end-of-filesystem marker */
-		t = write(outfd, pad, pad_len);
-		if (t != pad_len) {
-			ERRS("Unable to write to %s", name);
-			goto close;
-		}
-		out_len += pad_len;
+	if (write_pads(outfd, pos, pads, n_pads, seekable)) {
+		ERRS("Unable to write to %s", name);
+		goto close;
 	}
 
+	if (seekable && lseek(outfd, 0, SEEK_END) < 0)
+		goto close;
+
+	if (map_file && write_map(out_len - xtra_offset, pads, n_pads))
+		goto close;
+
 	ret = 0;
 
 close:
 	close(fd);
-free_buf:
-	free(buf);
 out:
 	return ret;
 }
@@ -146,6 +311,7 @@ static int usage(void)
 		"                        try to parse the entire firmware area as one big jffs2\n"
 		"  -j:                   (like -J, but little-endian instead of big-endian)\n"
 		"  -c:                   write padding to stdout\n"
+		"  -m <file>:            write a map of the padded regions to <file>\n"
 		"\n",
 		progname);
 	return EXIT_FAILURE;
@@ -169,7 +335,7 @@ int main(int argc, char* argv[])
 	argc--;
 
 	pad_mask = 0;
-	while ((ch = getopt(argc, argv, "x:Jjc")) != -1) {
+	while ((ch = getopt(argc, argv, "x:Jjcm:")) != -1) {
 		switch (ch) {
 		case 'x':
 			xtra_offset = strtoul(optarg, NULL, 0);
@@ -187,6 +353,9 @@ int main(int argc, char* argv[])
 		case 'c':
 			pad_to_stdout = true;
 			break;
+		case 'm':
+			map_file = optarg;
+			break;
 		default:
 			return usage();
 		}
@@ -0,0 +1,497 @@
+/*
+ * sparseimg - assemble disk images without writing zeros
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ *
+ * Components are placed into the image with pwrite() and all-zero blocks
+ * are left as holes, padding just extends the file. The final image is
+ * compressed (or its block map dumped) walking only data ranges, holes are
+ * fed to the compressor from a static zero buffer instead of being read.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <libgen.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <zlib.h>
+
+static char *progname;
+
+#define ERR(fmt, ...) do { \
+	fflush(0); \
+	fprintf(stderr, "[%s] *** error: " fmt "\n", \
+			progname, ## __VA_ARGS__ ); \
+} while (0)
+
+#define ERRS(fmt, ...) do { \
+	int save = errno; \
+	fflush(0); \
+	fprintf(stderr, "[%s] *** error: " fmt ", %s\n", \
+			progname, ## __VA_ARGS__, strerror(save)); \
+} while (0)
+
+#define BUF_SIZE	(1024 * 1024)
+#define BLOCK_SIZE	4096
+
+static uint8_t buf[BUF_SIZE];
+static uint8_t out_buf[BUF_SIZE];
+static const uint8_t zeros[BUF_SIZE];
+
+static int parse_size(const char *str, uint64_t *size)
+{
+	char *end;
+
+	*size = strtoull(str, &end, 0);
+	switch (*end) {
+	case 'G':
+	case 'g':
+		*size <<= 10;
+		/* fall through */
+	case 'M':
+	case 'm':
+		*size <<= 10;
+		/* fall through */
+	case 'K':
+	case 'k':
+		*size <<= 10;
+		end++;
+	}
+
+	if (end == str || *end) {
+		ERR("invalid size \"%s\"", str);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Finds the data range starting at or after pos. Files on filesystems
+ * without SEEK_DATA support are reported as a single data range.
+ */
+static void next_data(int fd, uint64_t pos, uint64_t size, uint64_t *start, uint64_t *end)
+{
+#ifdef SEEK_DATA
+	off_t data, hole;
+
+	data = lseek(fd, pos, SEEK_DATA);
+	if (data < 0) {
+		/* ENXIO: nothing but a hole up to EOF */
+		*start = errno == ENXIO ? size : pos;
+		*end = size;
+		return;
+	}
+
+	hole = lseek(fd, data, SEEK_HOLE);
+	*start = data;
+	*end = hole < 0 ? size : (uint64_t)hole;
+#else
+	*start = pos;
+	*end = size;
+#endif
+}
+
+static int pwrite_all(int fd, const uint8_t *data, size_t len, uint64_t offset)
+{
+	ssize_t bytes;
+
+	while (len) {
+		bytes = pwrite(fd, data, len, offset);
+		if (bytes < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		data += bytes;
+		len -= bytes;
+		offset += bytes;
+	}
+
+	return 0;
+}
+
+/**************************************************
+ * Image assembly
+ **************************************************/
+
+/* Copies file into the image at offset, skipping all-zero blocks */
+static int place_file(int fd, uint64_t offset, const char *path)
+{
+	uint64_t in_size, img_size, pos, start, end;
+	struct stat st;
+	int ret = -1;
+	int in;
+
+	in = open(path, O_RDONLY);
+	if (in < 0) {
+		ERRS("unable to open %s", path);
+		return -1;
+	}
+
+	if (fstat(in, &st)) {
+		ERRS("unable to stat %s", path);
+		goto out;
+	}
+	in_size = st.st_size;
+	if (fstat(fd, &st)) {
+		ERRS("unable to stat image");
+		goto out;
+	}
+	img_size = st.st_size;
+
+	for (pos = 0; pos < in_size; pos = end) {
+		next_data(in, pos, in_size, &start, &end);
+
+		for (pos = start; pos < end; ) {
+			size_t len = end - pos < BUF_SIZE ? end - pos : BUF_SIZE;
+			ssize_t bytes;
+			size_t i, run;
+
+			bytes = pread(in, buf, len, pos);
+			if (bytes <= 0) {
+				ERRS("unable to read %s", path);
+				goto out;
+			}
+
+			for (i = 0; i < bytes; i += run) {
+				bool zero;
+
+				run = bytes - i < BLOCK_SIZE ? bytes - i : BLOCK_SIZE;
+				zero = !memcmp(buf + i, zeros, run);
+
+				/* Coalesce blocks of the same kind */
+				while (i + run < bytes) {
+					size_t next = bytes - i - run < BLOCK_SIZE ? bytes - i - run : BLOCK_SIZE;
+
+					if (!memcmp(buf + i + run, zeros, next) != zero)
+						break;
+					run += next;
+				}
+
+				/* Zeros past the current end are a hole already */
+				if (zero && offset + pos + i >= img_size)
+					continue;
+
+				if (pwrite_all(fd, buf + i, run, offset + pos + i)) {
+					ERRS("unable to write image");
+					goto out;
+				}
+			}
+
+			pos += bytes;
+		}
+	}
+
+	if (offset + in_size > img_size && ftruncate(fd, offset + in_size)) {
+		ERRS("unable to resize image");
+		goto out;
+	}
+
+	ret = 0;
+out:
+	close(in);
+	return ret;
+}
+
+static int do_append(int argc, char **argv)
+{
+	struct stat st;
+	int ret = 0;
+	int fd;
+	int i;
+
+	if (argc < 2)
+		return -1;
+
+	fd = open(argv[0], O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		ERRS("unable to open %s", argv[0]);
+		return -1;
+	}
+
+	for (i = 1; i < argc && !ret; i++) {
+		if (fstat(fd, &st)) {
+			ERRS("unable to stat %s", argv[0]);
+			ret = -1;
+			break;
+		}
+		ret = place_file(fd, st.st_size, argv[i]);
+	}
+
+	close(fd);
+	return ret;
+}
+
+static int do_write(int argc, char **argv)
+{
+	uint64_t offset;
+	int ret;
+	int fd;
+
+	if (argc != 3 || parse_size(argv[1], &offset))
+		return -1;
+
+	fd = open(argv[0], O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		ERRS("unable to open %s", argv[0]);
+		return -1;
+	}
+
+	ret = place_file(fd, offset, argv[2]);
+
+	close(fd);
+	return ret;
+}
+
+/* Same as dd conv=sync: round the size up to a multiple of the alignment */
+static int do_pad(int argc, char **argv)
+{
+	uint64_t align, size;
+	struct stat st;
+	int ret = 0;
+	int fd;
+
+	if (argc != 2 || parse_size(argv[1], &align) || !align)
+		return -1;
+
+	fd = open(argv[0], O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		ERRS("unable to open %s", argv[0]);
+		return -1;
+	}
+
+	if (fstat(fd, &st)) {
+		ERRS("unable to stat %s", argv[0]);
+		ret = -1;
+	} else {
+		size = (st.st_size + align - 1) / align * align;
+		if (size != (uint64_t)st.st_size && ftruncate(fd, size)) {
+			ERRS("unable to resize %s", argv[0]);
+			ret = -1;
+		}
+	}
+
+	close(fd);
+	return ret;
+}
+
+/**************************************************
+ * Output
+ **************************************************/
+
+static int deflate_feed(z_stream *zs, FILE *out, const uint8_t *data, size_t len, int flush)
+{
+	zs->next_in = (Bytef *)data;
+	zs->avail_in = len;
+
+	do {
+		size_t have;
+
+		zs->next_out = out_buf;
+		zs->avail_out = sizeof(out_buf);
+		if (deflate(zs, flush) == Z_STREAM_ERROR)
+			return -1;
+
+		have = sizeof(out_buf) - zs->avail_out;
+		if (have && fwrite(out_buf, 1, have, out) != have)
+			return -1;
+	} while (zs->avail_out == 0);
+
+	return 0;
+}
+
+static int do_gzip(int argc, char **argv)
+{
+	uint64_t size, pos, start, end;
+	struct stat st;
+	z_stream zs = {};
+	FILE *out;
+	int ret = -1;
+	int fd;
+
+	if (argc != 2)
+		return -1;
+
+	fd = open(argv[0], O_RDONLY);
+	if (fd < 0) {
+		ERRS("unable to open %s", argv[0]);
+		return -1;
+	}
+
+	out = fopen(argv[1], "w");
+	if (!out) {
+		ERRS("unable to open %s", argv[1]);
+		goto out_close;
+	}
+
+	if (fstat(fd, &st)) {
+		ERRS("unable to stat %s", argv[0]);
+		goto out_fclose;
+	}
+	size = st.st_size;
+
+	/* Same as gzip -9n: no name, no timestamp */
+	if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9,
+			 Z_DEFAULT_STRATEGY) != Z_OK) {
+		ERR("unable to initialize zlib");
+		goto out_fclose;
+	}
+
+	for (pos = 0; pos < size; pos = end) {
+		next_data(fd, pos, size, &start, &end);
+
+		/* Hole */
+		while (pos < start) {
+			size_t len = start - pos < BUF_SIZE ? start - pos : BUF_SIZE;
+
+			if (deflate_feed(&zs, out, zeros, len, Z_NO_FLUSH))
+				goto out_deflate;
+			pos += len;
+		}
+
+		/* Data */
+		while (pos < end) {
+			size_t len = end - pos < BUF_SIZE ? end - pos : BUF_SIZE;
+			ssize_t bytes = pread(fd, buf, len, pos);
+
+			if (bytes <= 0) {
+				ERRS("unable to read %s", argv[0]);
+				goto out_deflate;
+			}
+			if (deflate_feed(&zs, out, buf, bytes, Z_NO_FLUSH))
+				goto out_deflate;
+			pos += bytes;
+		}
+	}
+
+	if (deflate_feed(&zs, out, NULL, 0, Z_FINISH))
+		goto out_deflate;
+
+	ret = 0;
+
+out_deflate:
+	if (ret)
+		ERR("unable to compress %s", argv[0]);
+	deflateEnd(&zs);
+out_fclose:
+	if (fclose(out) && !ret) {
+		ERRS("unable to write %s", argv[1]);
+		ret = -1;
+	}
+out_close:
+	close(fd);
+	return ret;
+}
+
+/* Lists block ranges which hold data, i.e. need to be written to a device */
+static int do_bmap(int argc, char **argv)
+{
+	uint64_t size, pos, start, end, mapped = 0;
+	struct stat st;
+	FILE *out;
+	int ret = -1;
+	int fd;
+
+	if (argc != 2)
+		return -1;
+
+	fd = open(argv[0], O_RDONLY);
+	if (fd < 0) {
+		ERRS("unable to open %s", argv[0]);
+		return -1;
+	}
+
+	out = fopen(argv[1], "w");
+	if (!out) {
+		ERRS("unable to open %s", argv[1]);
+		goto out_close;
+	}
+
+	if (fstat(fd, &st)) {
+		ERRS("unable to stat %s", argv[0]);
+		goto out_fclose;
+	}
+	size = st.st_size;
+
+	fprintf(out, "# sparseimg block map\n");
+	fprintf(out, "ImageSize %" PRIu64 "\n", size);
+	fprintf(out, "BlockSize %u\n", BLOCK_SIZE);
+	fprintf(out, "BlocksCount %" PRIu64 "\n", (size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+
+	for (pos = 0; pos < size; pos = end) {
+		next_data(fd, pos, size, &start, &end);
+		if (start >= end)
+			break;
+
+		start /= BLOCK_SIZE;
+		end = (end + BLOCK_SIZE - 1) / BLOCK_SIZE;
+		fprintf(out, "Range %" PRIu64 "-%" PRIu64 "\n", start, end - 1);
+		mapped += end - start;
+		end *= BLOCK_SIZE;
+	}
+
+	fprintf(out, "MappedBlocksCount %" PRIu64 "\n", mapped);
+	ret = 0;
+
+out_fclose:
+	if (fclose(out) && !ret) {
+		ERRS("unable to write %s", argv[1]);
+		ret = -1;
+	}
+out_close:
+	close(fd);
+	return ret;
+}
+
+static int usage(void)
+{
+	fprintf(stderr,
+		"Usage: %s <command> <image> <args>\n"
+		"\n"
+		"  append <image> <file>...      append files to the image\n"
+		"  write <image> <offset> <file> place file at offset\n"
+		"  pad <image> <size>            pad image to a multiple of size\n"
+		"  gzip <image> <output>         gzip the image\n"
+		"  bmap <image> <output>         write block map of the image\n"
+		"\n"
+		"Sizes accept K, M and G suffixes.\n",
+		progname);
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	int ret = -1;
+
+	progname = basename(argv[0]);
+
+	if (argc < 3)
+		return usage();
+
+	if (!strcmp(argv[1], "append"))
+		ret = do_append(argc - 2, argv + 2);
+	else if (!strcmp(argv[1], "write"))
+		ret = do_write(argc - 2, argv + 2);
+	else if (!strcmp(argv[1], "pad"))
+		ret = do_pad(argc - 2, argv + 2);
+	else if (!strcmp(argv[1], "gzip"))
+		ret = do_gzip(argc - 2, argv + 2);
+	else if (!strcmp(argv[1], "bmap"))
+		ret = do_bmap(argc - 2, argv + 2);
+	else
+		return usage();
+
+	return ret ? 1 : 0;
+}